@@ -88,11 +88,7 @@ void loop() {
       byte buffer[80];
       int count = clients[i].read(buffer, 80);
       // write the bytes to all other connected clients
-      for (byte j=0; j < MAX_CLIENTS; j++) {
-        if (j != i && clients[j].connected()) {
-          clients[j].write(buffer, count);
-        }
-      }
+      server.broadcast(clients, MAX_CLIENTS, buffer, count, &clients[i]);
     }
   }
 
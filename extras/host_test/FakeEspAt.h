@@ -0,0 +1,197 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _FAKE_ESP_AT_H_
+#define _FAKE_ESP_AT_H_
+
+#include <Arduino.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * The serial side of an AT 1 firmware in passive receive mode, which echoes
+ * the data sent on a TCP link back to it. Only the commands used by
+ * WiFiClient are implemented, the others return OK.
+ * A command is executed when its line ends.
+ * Bytes of a command (or of the data of AT+CIPSEND) written from another
+ * thread than the one which started it and bytes of a response read
+ * from another thread than the one which sent the command are counted
+ * in interleavedCommands.
+ */
+class FakeEspAt : public Stream {
+public:
+
+  static const int LINKS_COUNT = 5;
+
+  unsigned long interleavedCommands = 0;
+  unsigned long commandCount = 0;
+
+  size_t write(uint8_t b) override {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    std::thread::id thread = std::this_thread::get_id();
+    if (line.empty() && !sendLength) {
+      commandThread = thread;
+    } else if (thread != commandThread) {
+      interleavedCommands++;
+    }
+    if (sendLength) {
+      sendData += (char) b;
+      if (sendData.size() == sendLength) {
+        sendDone();
+      }
+      return 1;
+    }
+    if (b != '\n') {
+      line += (char) b;
+      return 1;
+    }
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    commandCount++;
+    command(line);
+    line.clear();
+    return 1;
+  }
+
+  int available() override {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    return rx.size();
+  }
+
+  int read() override {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    if (rx.empty())
+      return -1;
+    uint8_t b = rx.front().first;
+    if (rx.front().second != std::thread::id() && rx.front().second != std::this_thread::get_id()) {
+      interleavedCommands++;
+    }
+    rx.pop_front();
+    return b;
+  }
+
+  int peek() override {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    return rx.empty() ? -1 : (uint8_t) rx.front().first;
+  }
+
+private:
+
+  struct Link {
+    bool connected = false;
+    std::string data; // received, not yet read with AT+CIPRECVDATA
+  };
+
+  std::recursive_mutex mutex;
+  std::deque<std::pair<char, std::thread::id>> rx; // with the thread of the command. no thread for +IPD
+  std::string line;
+  std::thread::id commandThread;
+  Link links[LINKS_COUNT];
+  int sendLinkId = 0;
+  size_t sendLength = 0;
+  std::string sendData;
+
+  void respond(const std::string& s, bool unsolicited = false) {
+    for (char c : s) {
+      rx.emplace_back(c, unsolicited ? std::thread::id() : commandThread);
+    }
+  }
+
+  bool startsWith(const std::string& s, const char* prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+  }
+
+  void command(const std::string& cmd) {
+    if (cmd == "AT+RST") {
+      for (Link& link : links) {
+        link = Link();
+      }
+      respond("\r\nOK\r\nready\r\n");
+    } else if (cmd == "AT+CWMODE?") {
+      respond("+CWMODE:1\r\n\r\nOK\r\n");
+    } else if (cmd == "AT+CIPSTATUS") {
+      std::string s = "STATUS:2\r\n";
+      for (int i = 0; i < LINKS_COUNT; i++) {
+        if (links[i].connected) {
+          s += "+CIPSTATUS:" + std::to_string(i) + ",\"TCP\",\"192.168.1.2\",7,5000" + std::to_string(i) + ",0\r\n";
+        }
+      }
+      respond(s + "\r\nOK\r\n");
+    } else if (startsWith(cmd, "AT+CIPSTART=")) {
+      int linkId = atoi(cmd.c_str() + strlen("AT+CIPSTART="));
+      if (linkId >= LINKS_COUNT || links[linkId].connected) {
+        respond("\r\nERROR\r\n");
+        return;
+      }
+      links[linkId] = Link();
+      links[linkId].connected = true;
+      respond(std::to_string(linkId) + ",CONNECT\r\n\r\nOK\r\n");
+    } else if (startsWith(cmd, "AT+CIPSEND=")) {
+      int linkId = atoi(cmd.c_str() + strlen("AT+CIPSEND="));
+      if (linkId >= LINKS_COUNT || !links[linkId].connected) {
+        respond("\r\nERROR\r\n");
+        return;
+      }
+      sendLinkId = linkId;
+      sendLength = atol(strchr(cmd.c_str(), ',') + 1);
+      sendData.clear();
+      respond("\r\nOK\r\n> ");
+    } else if (startsWith(cmd, "AT+CIPRECVDATA=")) {
+      int linkId = atoi(cmd.c_str() + strlen("AT+CIPRECVDATA="));
+      size_t length = atol(strchr(cmd.c_str(), ',') + 1);
+      if (linkId >= LINKS_COUNT || links[linkId].data.empty()) {
+        respond("\r\nERROR\r\n");
+        return;
+      }
+      Link& link = links[linkId];
+      std::string data = link.data.substr(0, length);
+      link.data.erase(0, data.size());
+      respond("+CIPRECVDATA," + std::to_string(data.size()) + ":" + data + "\r\nOK\r\n");
+    } else if (cmd == "AT+CIPRECVLEN?") {
+      std::string s = "+CIPRECVLEN:";
+      for (int i = 0; i < LINKS_COUNT; i++) {
+        s += (i ? "," : "") + std::to_string(links[i].data.size());
+      }
+      respond(s + "\r\n\r\nOK\r\n");
+    } else if (startsWith(cmd, "AT+CIPCLOSE=")) {
+      int linkId = atoi(cmd.c_str() + strlen("AT+CIPCLOSE="));
+      if (linkId >= LINKS_COUNT || !links[linkId].connected) {
+        respond("\r\nERROR\r\n");
+        return;
+      }
+      links[linkId] = Link();
+      respond(std::to_string(linkId) + ",CLOSED\r\n\r\nOK\r\n");
+    } else {
+      respond("\r\nOK\r\n");
+    }
+  }
+
+  void sendDone() {
+    Link& link = links[sendLinkId];
+    link.data += sendData;
+    respond("\r\nRecv " + std::to_string(sendLength) + " bytes\r\n\r\nSEND OK\r\n");
+    respond("+IPD," + std::to_string(sendLinkId) + "," + std::to_string(link.data.size()) + "\r\n", true);
+    sendLength = 0;
+    sendData.clear();
+  }
+};
+
+#endif
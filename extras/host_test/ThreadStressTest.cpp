@@ -0,0 +1,98 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Host test of WIFIESPAT_THREAD_SAFE. Threads connect, write, read back
+ * and stop their own WiFiClient through the one locked EspAtDrv, with
+ * FakeEspAt as the serial line to the AT firmware. Fails if an echo
+ * doesn't match or if commands of two threads were interleaved.
+ */
+
+#include <WiFi.h>
+#include <atomic>
+#include <thread>
+#include "FakeEspAt.h"
+
+#ifndef WIFIESPAT_THREAD_SAFE
+#error define WIFIESPAT_THREAD_SAFE
+#endif
+
+const int THREADS_COUNT = 4; // less than the links count
+const int ROUNDS = 200;
+
+FakeEspAt fakeEspAt;
+std::atomic<int> failures(0);
+
+static bool exchange(WiFiClient& client, const char* msg, size_t length) {
+  if (client.write((const uint8_t*) msg, length) != length)
+    return false;
+  client.flush();
+  char buff[200];
+  size_t count = 0;
+  unsigned long start = millis();
+  while (count < length && millis() - start < 2000) {
+    int n = client.read((uint8_t*) buff + count, sizeof(buff) - count);
+    if (n > 0) {
+      count += n;
+    } else {
+      yield();
+    }
+  }
+  return count == length && !memcmp(buff, msg, length);
+}
+
+static void clientThread(int id) {
+  char msg[200];
+  for (int i = 0; i < ROUNDS; i++) {
+    WiFiClient client;
+    if (!client.connect("echo.test", 7)) {
+      printf("thread %d round %d: connect failed\n", id, i);
+      failures++;
+      continue;
+    }
+    // short messages stay in the TX buffer until flush, long ones are sent directly
+    size_t length = snprintf(msg, sizeof(msg), "thread %d round %d ", id, i);
+    size_t total = (i % 2) ? sizeof(msg) - 1 : length;
+    for (size_t j = length; j < total; j++) {
+      msg[j] = 'a' + (j % 26);
+    }
+    if (!exchange(client, msg, total)) {
+      printf("thread %d round %d: echo failed\n", id, i);
+      failures++;
+    }
+    client.stop();
+  }
+}
+
+int main() {
+  fakeEspAt.setTimeout(200);
+  if (!WiFi.init(fakeEspAt)) {
+    printf("init failed\n");
+    return 1;
+  }
+  std::thread threads[THREADS_COUNT];
+  for (int i = 0; i < THREADS_COUNT; i++) {
+    threads[i] = std::thread(clientThread, i);
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  printf("%lu commands, %lu interleaved, %d failures\n", fakeEspAt.commandCount,
+      fakeEspAt.interleavedCommands, (int) failures);
+  return (failures || fakeEspAt.interleavedCommands) ? 1 : 0;
+}
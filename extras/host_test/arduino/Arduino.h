@@ -0,0 +1,87 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _HOST_TEST_ARDUINO_H_
+#define _HOST_TEST_ARDUINO_H_
+
+// the part of the Arduino API used by the library, for the host test
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper*) (s))
+#define PSTR(s) (s)
+#define PROGMEM
+typedef const char* PGM_P;
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define pgm_read_byte(p) (*(const uint8_t*) (p))
+
+#define DEC 10
+#define HEX 16
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+
+inline char* itoa(int value, char* s, int base) {
+  sprintf(s, base == 16 ? "%x" : "%d", value);
+  return s;
+}
+
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+class String : public std::string {
+public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+};
+
+// log output of the library
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t b) override {return fputc(b, stderr) == EOF ? 0 : 1;}
+  int available() override {return 0;}
+  int read() override {return -1;}
+  int peek() override {return -1;}
+  operator bool() {return true;}
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,73 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h> // includes this file after its declarations
+
+#ifndef _HOST_TEST_IPADDRESS_H_
+#define _HOST_TEST_IPADDRESS_H_
+
+class IPAddress : public Printable {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    bytes[0] = b0;
+    bytes[1] = b1;
+    bytes[2] = b2;
+    bytes[3] = b3;
+  }
+  IPAddress(uint32_t address) {memcpy(bytes, &address, 4);}
+  IPAddress(const uint8_t* address) {memcpy(bytes, address, 4);}
+
+  operator uint32_t() const {
+    uint32_t address;
+    memcpy(&address, bytes, 4);
+    return address;
+  }
+  bool operator==(const IPAddress& other) const {return !memcmp(bytes, other.bytes, 4);}
+  bool operator!=(const IPAddress& other) const {return !(*this == other);}
+  uint8_t operator[](int index) const {return bytes[index];}
+  uint8_t& operator[](int index) {return bytes[index];}
+
+  bool fromString(const char* s) {
+    unsigned b[4];
+    if (sscanf(s, "%u.%u.%u.%u", &b[0], &b[1], &b[2], &b[3]) != 4)
+      return false;
+    for (int i = 0; i < 4; i++) {
+      bytes[i] = b[i];
+    }
+    return true;
+  }
+
+  size_t printTo(Print& p) const override {
+    size_t n = 0;
+    for (int i = 0; i < 4; i++) {
+      if (i) {
+        n += p.print('.');
+      }
+      n += p.print(bytes[i]);
+    }
+    return n;
+  }
+
+private:
+  uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif
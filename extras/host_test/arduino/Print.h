@@ -0,0 +1,92 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h> // includes this file after its declarations
+
+#ifndef _HOST_TEST_PRINT_H_
+#define _HOST_TEST_PRINT_H_
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- && write(*buffer++)) {
+      n++;
+    }
+    return n;
+  }
+  size_t write(const char* s) {return write((const uint8_t*) s, strlen(s));}
+  size_t write(const char* buffer, size_t size) {return write((const uint8_t*) buffer, size);}
+  virtual int availableForWrite() {return 0;}
+  virtual void flush() {}
+
+  int getWriteError() {return writeError;}
+  void clearWriteError() {writeError = 0;}
+
+  size_t print(const __FlashStringHelper* s) {return write((const char*) s);}
+  size_t print(const char* s) {return write(s);}
+  size_t print(char c) {return write((uint8_t) c);}
+  size_t print(unsigned char n, int base = DEC) {return print((unsigned long) n, base);}
+  size_t print(int n, int base = DEC) {return print((long) n, base);}
+  size_t print(unsigned int n, int base = DEC) {return print((unsigned long) n, base);}
+  size_t print(long n, int base = DEC) {
+    char s[24];
+    snprintf(s, sizeof(s), base == HEX ? "%lX" : "%ld", n);
+    return write(s);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    char s[24];
+    snprintf(s, sizeof(s), base == HEX ? "%lX" : "%lu", n);
+    return write(s);
+  }
+  size_t print(double d, int digits = 2) {
+    char s[32];
+    snprintf(s, sizeof(s), "%.*f", digits, d);
+    return write(s);
+  }
+  size_t print(const Printable& p) {return p.printTo(*this);}
+
+  size_t println() {return write("\r\n");}
+  template<typename T> size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template<typename T> size_t println(T value, int base) {
+    size_t n = print(value, base);
+    return n + println();
+  }
+
+protected:
+  void setWriteError(int error = 1) {writeError = error;}
+
+private:
+  int writeError = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h> // includes this file after its declarations
+
+#ifndef _HOST_TEST_STREAM_H_
+#define _HOST_TEST_STREAM_H_
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) {_timeout = timeout;}
+  unsigned long getTimeout() {return _timeout;}
+
+  size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = timedRead();
+      if (c < 0)
+        break;
+      *buffer++ = (char) c;
+      count++;
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) {return readBytes((char*) buffer, length);}
+
+  size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = timedRead();
+      if (c < 0 || c == terminator)
+        break;
+      *buffer++ = (char) c;
+      count++;
+    }
+    return count;
+  }
+  size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+    return readBytesUntil(terminator, (char*) buffer, length);
+  }
+
+protected:
+  unsigned long _timeout = 1000;
+
+  int timedRead() {
+    unsigned long start = millis();
+    do {
+      int c = read();
+      if (c >= 0)
+        return c;
+      yield();
+    } while (millis() - start < _timeout);
+    return -1;
+  }
+};
+
+#endif
@@ -81,12 +81,72 @@ bool WiFiClass::setAutoConnect(bool autoConnect) {
 }
 
 int WiFiClass::begin(const char* ssid, const char* passphrase, const uint8_t* bssid) {
+  fastConfigEnd();
   bool ok = EspAtDrv.joinAP(ssid, passphrase, bssid);
   state = ok ? WL_CONNECTED : WL_CONNECT_FAILED;
   return state;
 }
 
+/**
+ * With a valid profile for the SSID, the join skips the search of the AP
+ * and DHCP. If it fails, the profile is invalidated and a full join with DHCP
+ * runs. After a successful full join the profile is filled.
+ */
+int WiFiClass::beginFast(const char* ssid, const char* passphrase, WiFiFastConnectProfile& profile) {
+  if (profile.valid && !strcmp(profile.ssid, ssid)) {
+    bool ok = config(IPAddress(profile.ip), IPAddress(profile.dns), IPAddress(profile.gateway), IPAddress(profile.subnet));
+    fastConfig = true; // set after config(), which clears it
+    if (ok && EspAtDrv.joinAP(ssid, passphrase, profile.bssid)) {
+      state = WL_CONNECTED;
+      return state;
+    }
+    profile.valid = false;
+  }
+  fastConfigEnd();
+  if (!EspAtDrv.joinAP(ssid, passphrase, nullptr)) {
+    state = WL_CONNECT_FAILED;
+    return state;
+  }
+  state = WL_CONNECTED;
+
+  uint8_t bssid[6];
+  uint8_t channel;
+  int8_t rssi;
+  IPAddress ip;
+  IPAddress gw;
+  IPAddress mask;
+  IPAddress dns1;
+  IPAddress dns2;
+  if (EspAtDrv.apQuery(nullptr, bssid, channel, rssi) && EspAtDrv.staIpQuery(ip, gw, mask)
+      && EspAtDrv.dnsQuery(dns1, dns2)) {
+    memcpy(profile.bssid, bssid, sizeof(profile.bssid));
+    profile.channel = channel;
+    for (uint8_t i = 0; i < 4; i++) {
+      profile.ip[i] = ip[i];
+      profile.gateway[i] = gw[i];
+      profile.subnet[i] = mask[i];
+      profile.dns[i] = dns1[i];
+    }
+    strncpy(profile.ssid, ssid, sizeof(profile.ssid) - 1);
+    profile.ssid[sizeof(profile.ssid) - 1] = 0;
+    profile.valid = true;
+  }
+  return state;
+}
+
+/**
+ * Enables DHCP again if beginFast applied the static addresses of a profile,
+ * so a following full join doesn't run with the old lease address.
+ */
+void WiFiClass::fastConfigEnd() {
+  if (fastConfig) {
+    fastConfig = false;
+    EspAtDrv.staEnableDHCP();
+  }
+}
+
 int WiFiClass::beginEnterprise(const char* ssid, uint8_t method, const char* username, const char* passphrase, const char* identity, uint8_t security) {
+  fastConfigEnd();
   bool ok = EspAtDrv.joinEAP(ssid, method,  identity, passphrase, username, security);
   state = ok ? WL_CONNECTED : WL_CONNECT_FAILED;
   return state;
@@ -100,6 +160,7 @@ int WiFiClass::disconnect(bool persistent) {
 }
 
 bool WiFiClass::config(IPAddress local_ip, IPAddress dns_server, IPAddress gateway, IPAddress subnet) {
+  fastConfig = false; // the sketch's own configuration is kept
 
   if (local_ip == INADDR_NONE)
     return EspAtDrv.staEnableDHCP();
@@ -156,6 +217,10 @@ IPAddress WiFiClass::subnetMask() {
   return mask;
 }
 
+bool WiFiClass::networkSnapshot(WiFiNetworkSnapshot& snapshot) {
+  return EspAtDrv.networkSnapshot(snapshot);
+}
+
 IPAddress WiFiClass::dnsIP(int n) {
   IPAddress dns1;
   IPAddress dns2;
@@ -213,13 +278,54 @@ int8_t WiFiClass::scanNetworks() {
   return scanNetworks(apDataInternal, WIFIESPAT_INTERNAL_AP_LIST_SIZE);
 }
 
-int8_t WiFiClass::scanNetworks(WiFiApData* _apData, uint8_t _apDataSize) {
+int8_t WiFiClass::scanNetworks(WiFiApData* _apData, uint8_t _apDataSize, const WiFiScanFilter* filter) {
   apData = _apData;
   apDataSize = _apDataSize;
-  apDataLength = EspAtDrv.listAP(apData, apDataSize);
+  apDataLength = EspAtDrv.listAP(apData, apDataSize, filter);
   return apDataLength;
 }
 
+bool WiFiClass::scanNetworksAsync(const WiFiScanFilter* filter) {
+  return scanNetworksAsync(apDataInternal, WIFIESPAT_INTERNAL_AP_LIST_SIZE, filter);
+}
+
+bool WiFiClass::scanNetworksAsync(WiFiApData* _apData, uint8_t _apDataSize, const WiFiScanFilter* filter) {
+  // scanAsync first delivers the rest of a running scan. the new scan's records come after it returns
+  if (!EspAtDrv.scanAsync(scanResult, filter))
+    return false;
+  apData = _apData;
+  apDataSize = _apDataSize;
+  apDataLength = 0;
+  return true;
+}
+
+int8_t WiFiClass::scanComplete() {
+  switch (EspAtDrv.scanAsyncStatus()) {
+    case ESPAT_SCAN_RUNNING:
+      return WIFI_SCAN_RUNNING;
+    case ESPAT_SCAN_FAILED:
+      return WIFI_SCAN_FAILED;
+    default:
+      return apDataLength;
+  }
+}
+
+void WiFiClass::scanResult(const WiFiApData& ap) {
+  // insertion into the array sorted by RSSI. the weakest AP falls out of the full array
+  uint8_t i = WiFi.apDataLength;
+  if (i == WiFi.apDataSize) {
+    if (!i || ap.rssi <= WiFi.apData[i - 1].rssi)
+      return;
+    i--;
+  } else {
+    WiFi.apDataLength++;
+  }
+  for (; i > 0 && WiFi.apData[i - 1].rssi < ap.rssi; i--) {
+    WiFi.apData[i] = WiFi.apData[i - 1];
+  }
+  WiFi.apData[i] = ap;
+}
+
 const char* WiFiClass::SSID(uint8_t index) {
   if (index >= apDataLength)
     return nullptr;
@@ -257,7 +363,7 @@ bool WiFiClass::startMDNS(const char* hostname, const char* serverName, uint16_t
 }
 
 bool WiFiClass::hostByName(const char* hostname, IPAddress& result) {
-  return EspAtDrv.resolve(hostname, result);
+  return WiFiEspAtDnsCache.resolve(hostname, result);
 }
 
 bool WiFiClass::ping(const char* hostname) {
@@ -275,7 +381,48 @@ bool WiFiClass::sntp(const char* server1, const char* server2) {
 }
 
 unsigned long WiFiClass::getTime() {
-  return EspAtDrv.sntpTime();
+  return getTimeMillis() / 1000;
+}
+
+uint64_t WiFiClass::getTimeMillis() {
+  if (!timeAnchor || millis() - timeSyncMillis >= timeSyncInterval) {
+    syncTime(); // if it fails, the local clock continues
+  }
+  if (!timeAnchor)
+    return 0;
+  return (uint64_t) timeAnchor * 1000 + (millis() - timeAnchorMillis);
+}
+
+/**
+ * The AT firmware reports whole seconds, so the queries are repeated
+ * until the second changes. The change happened between the middles
+ * of the round-trips of the last two queries.
+ */
+bool WiFiClass::syncTime() {
+  timeSyncMillis = millis();
+  unsigned long mid;
+  unsigned long t = EspAtDrv.sntpTime(&mid);
+  if (t < 1000000000UL) // SNTP didn't set the time yet (or error)
+    return false;
+  unsigned long start = millis();
+  while (millis() - start < 1100) {
+    unsigned long nextMid;
+    unsigned long next = EspAtDrv.sntpTime(&nextMid);
+    if (!next)
+      break;
+    if (next != t) {
+      timeAnchor = next;
+      timeAnchorMillis = mid + (nextMid - mid) / 2;
+      timeError = (nextMid - mid + 1) / 2;
+      return true;
+    }
+    mid = nextMid;
+  }
+  // the change of the second was not found. middle of the second
+  timeAnchor = t;
+  timeAnchorMillis = mid - 500;
+  timeError = 500;
+  return true;
 }
 
 int WiFiClass::beginAP(const char *ssid, const char* passphrase, uint8_t channel, uint8_t encryptionType, uint8_t maxConnetions, bool hidden) {
@@ -25,12 +25,22 @@
 #include "WiFiEspAtConfig.h"
 #include "utility/EspAtDrvTypes.h"
 #include "WiFiClient.h"
+#include "WiFiClientT.h"
+#include "WiFiClientPool.h"
+#include "WiFiEspAtDnsCache.h"
+#include "WiFiHttpClient.h"
 #include "WiFiServer.h"
 #include "WiFiUdp.h"
 #include "WiFiSSLClient.h"
+#include "WiFiPoll.h"
+#include "WiFiEspAtConnManager.h"
 
 #define WIFIESPAT_LIB_VERSION 2
 
+// scanComplete() return values (like in esp32 WiFi library)
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
 enum {
   WL_NO_SHIELD = 255,
   WL_NO_MODULE = WL_NO_SHIELD,
@@ -78,6 +88,8 @@ public:
 #else
   int begin(const char* ssid = nullptr, const char *passphrase = nullptr, const uint8_t* bssid = nullptr);
 #endif
+  // joins the AP of the profile with the addresses of the profile. fills the profile after a full join
+  int beginFast(const char* ssid, const char* passphrase, WiFiFastConnectProfile& profile);
   int beginEnterprise(const char* ssid, uint8_t method, const char* username, const char* passphrase, const char* identity, uint8_t security);
   int disconnect(bool persistent = false);
 
@@ -92,6 +104,8 @@ public:
   IPAddress gatewayIP();
   IPAddress subnetMask();
   IPAddress dnsIP(int n = 0);
+  // all addresses, MACs, hostname and DHCP states. queried again only after a change
+  bool networkSnapshot(WiFiNetworkSnapshot& snapshot);
   bool dhcpIsEnabled();
 
   // WiFi network parameters
@@ -102,7 +116,11 @@ public:
 
   // enumerate WiFi access points
   int8_t scanNetworks(); // using internal array will occupy a lot of SRAM
-  int8_t scanNetworks(WiFiApData* _apData, uint8_t apDataSize); // optional version
+  int8_t scanNetworks(WiFiApData* _apData, uint8_t apDataSize, const WiFiScanFilter* filter = nullptr); // optional version
+  // returns without waiting. apData will hold the apDataSize strongest APs passing the filter
+  bool scanNetworksAsync(const WiFiScanFilter* filter = nullptr);
+  bool scanNetworksAsync(WiFiApData* _apData, uint8_t apDataSize, const WiFiScanFilter* filter = nullptr);
+  int8_t scanComplete(); // count of APs or WIFI_SCAN_RUNNING or WIFI_SCAN_FAILED
   const char* SSID(uint8_t index);
   uint8_t encryptionType(uint8_t index);
   uint8_t* BSSID(uint8_t index, uint8_t* bssid);
@@ -119,7 +137,11 @@ public:
   bool ping(IPAddress ip);
 
   bool sntp(const char* server1, const char* server2 = nullptr);
-  unsigned long getTime();
+  unsigned long getTime(); // from the local clock. see syncTime()
+  uint64_t getTimeMillis(); // epoch time in milliseconds
+  bool syncTime(); // sets the local clock from the AT firmware. takes up to a second
+  void setTimeSyncInterval(unsigned long interval) {timeSyncInterval = interval;}
+  unsigned long timeSyncError() {return timeError;} // +- milliseconds of the last sync
 
   // AP related functions:
 
@@ -160,8 +182,11 @@ public:
 
 private:
   uint8_t mapAtEnc2ArduinoEnc(uint8_t encryptionType);
+  static void scanResult(const WiFiApData& ap);
+  void fastConfigEnd();
 
   uint8_t state = WL_NO_MODULE;
+  bool fastConfig = false; // beginFast set the static IP of a profile
 
   // this members are removed by compiler if the corresponding function is not used
   static char fwVersion[]; // static is for use as default parameter value of function
@@ -172,6 +197,12 @@ private:
   uint8_t apMaxConn;
   bool apHidden;
 
+  unsigned long timeAnchor = 0; // epoch seconds at timeAnchorMillis
+  unsigned long timeAnchorMillis = 0;
+  unsigned long timeSyncMillis = 0;
+  unsigned long timeSyncInterval = WIFIESPAT_TIME_SYNC_INTERVAL;
+  unsigned long timeError = 0;
+
   static WiFiApData apDataInternal[];
   WiFiApData* apData;
   uint8_t apDataSize;
@@ -20,12 +20,14 @@
 #include "utility/EspAtDrv.h"
 #include "WiFiClient.h"
 #include "WiFiEspAtBuffManager.h"
+#include "WiFiEspAtDnsCache.h"
 
 WiFiClient::WiFiClient() {
 }
 
-WiFiClient::WiFiClient(uint8_t linkId) {
-  stream = WiFiEspAtBuffManager.getBuffStream(linkId, WIFIESPAT_CLIENT_RX_BUFFER_SIZE, WIFIESPAT_CLIENT_TX_BUFFER_SIZE);
+WiFiClient::WiFiClient(uint8_t linkId, size_t _rxBufferSize, size_t _txBufferSize) {
+  setBufferSizes(_rxBufferSize, _txBufferSize);
+  stream = WiFiEspAtBuffManager.getBuffStream(linkId, rxBufferSize, txBufferSize);
   if (!stream) {
     EspAtDrv.close(linkId);
   }
@@ -35,10 +37,31 @@ int WiFiClient::connect(bool ssl, const char* host, uint16_t port) {
   if (stream) {
     stop();
   }
-  uint8_t linkId = EspAtDrv.connect(ssl ? "SSL" : "TCP", host, port);
-  if (linkId == NO_LINK)
+  char ip[16];
+  bool cached = !ssl && WiFiEspAtDnsCache.resolveForConnect(host, ip);
+  uint8_t linkId = EspAtDrv.connect(ssl ? "SSL" : "TCP", cached ? ip : host, port,
+#ifdef WIFIESPAT1
+      nullptr,
+#endif
+      0, ssl ? tlsConfig : nullptr);
+  if (linkId == NO_LINK) {
+    EspAtDrvError error = EspAtDrv.getLastErrorCode();
+    // the address could be outdated if the connect failed or timed out. not on a local error like NO_FREE_LINK
+    if (cached && (error == EspAtDrvError::AT_ERROR || error == EspAtDrvError::AT_NOT_RESPONDIG)) {
+      WiFiEspAtDnsCache.remove(host);
+    }
     return false;
-  stream = WiFiEspAtBuffManager.getBuffStream(linkId, WIFIESPAT_CLIENT_RX_BUFFER_SIZE, WIFIESPAT_CLIENT_TX_BUFFER_SIZE);
+  }
+  return attach(linkId);
+}
+
+bool WiFiClient::attach(uint8_t linkId) {
+#ifndef WIFIESPAT1
+  if (tcpOptions) {
+    EspAtDrv.tcpOptions(linkId, *tcpOptions);
+  }
+#endif
+  stream = WiFiEspAtBuffManager.getBuffStream(linkId, rxBufferSize, txBufferSize);
   if (!stream) {
     EspAtDrv.close(linkId);
     return false;
@@ -68,7 +91,35 @@ int WiFiClient::connectSSL(IPAddress ip, uint16_t port) {
   return connect(true, ip, port);
 }
 
+int WiFiClient::connectAsync(const char* host, uint16_t port, bool ssl, unsigned long timeout) {
+  stop();
+  asyncLinkId = EspAtDrv.connectAsync(ssl ? "SSL" : "TCP", host, port, timeout, ssl ? tlsConfig : nullptr);
+  return (asyncLinkId != NO_LINK);
+}
+
+EspAtConnectStatus WiFiClient::connectAsyncStatus() {
+  if (asyncLinkId == NO_LINK)
+    return stream ? ESPAT_CONNECT_SUCCESS : ESPAT_CONNECT_FAILED;
+  EspAtConnectStatus status = EspAtDrv.connectAsyncStatus(asyncLinkId);
+  if (status == ESPAT_CONNECT_PENDING)
+    return status;
+  uint8_t linkId = asyncLinkId;
+  asyncLinkId = NO_LINK;
+  if (status == ESPAT_CONNECT_SUCCESS && !attach(linkId))
+    return ESPAT_CONNECT_FAILED;
+  return status;
+}
+
+void WiFiClient::setBufferSizes(size_t _rxBufferSize, size_t _txBufferSize) {
+  rxBufferSize = _rxBufferSize ? _rxBufferSize : 1; // RX buffer must be at least 1 for peek()
+  txBufferSize = _txBufferSize ? _txBufferSize : 1; // write(uint8_t) stores the byte in the TX buffer
+}
+
 void WiFiClient::stop() {
+  if (asyncLinkId != NO_LINK) {
+    EspAtDrv.connectAsyncCancel(asyncLinkId);
+    asyncLinkId = NO_LINK;
+  }
   if (!stream)
     return;
   flush();
@@ -137,6 +188,24 @@ int WiFiClient::peek() {
   return stream->peek();
 }
 
+size_t WiFiClient::peekAvailable() {
+  if (!stream)
+    return 0;
+  return stream->peekAvailable();
+}
+
+const char* WiFiClient::peekBuffer() {
+  if (!stream)
+    return nullptr;
+  return (const char*) stream->peekBuffer();
+}
+
+void WiFiClient::peekConsume(size_t size) {
+  if (!stream)
+    return;
+  stream->peekConsume(size);
+}
+
 WiFiClient::operator bool() {
   return !!stream;
 }
@@ -39,11 +39,15 @@ enum WiFiTcpState {
 };
 
 class WiFiServer;
+class WiFiPoll;
+class WiFiClientPool;
 
 class WiFiClient : public Client {
 
   friend WiFiServer;
-  WiFiClient(uint8_t linkId);
+  friend WiFiPoll;
+  friend WiFiClientPool;
+  WiFiClient(uint8_t linkId, size_t rxBufferSize, size_t txBufferSize);
 
 public:
   WiFiClient();
@@ -55,6 +59,20 @@ public:
   virtual void stop();
           void abort();
 
+  // starts the connection and returns without waiting. 0 if it can't be started
+  int connectAsync(const char *host, uint16_t port, bool ssl = false, unsigned long timeout = 10000);
+  // poll until the result is not ESPAT_CONNECT_PENDING. stop() cancels the pending connection
+  EspAtConnectStatus connectAsyncStatus();
+
+  // TLS settings for connectSSL. the object must exist while connecting
+  void setTlsConfig(const WiFiTlsConfig* config) {tlsConfig = config;}
+
+  // AT 2 TCP options applied after connect. the object must exist while connecting
+  void setTcpOptions(const WiFiTcpOptions* options) {tcpOptions = options;}
+
+  // buffer sizes for the next connection. default are the sizes from WiFiEspAtConfig.h
+  void setBufferSizes(size_t rxBufferSize, size_t txBufferSize);
+
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
   virtual void flush();
@@ -67,12 +85,21 @@ public:
   virtual int read(uint8_t *buf, size_t size);
   virtual int peek();
 
+  // zero-copy reading. peekBuffer() points to peekAvailable() bytes in the RX buffer
+  size_t peekAvailable();
+  const char* peekBuffer();
+  void peekConsume(size_t size);
+
   virtual operator bool();
   virtual uint8_t connected();
   uint8_t status();
 
-  // remoteIP and the ports are not stored
-  // every call to these functions retrieves the value from AT firmware
+  // true if both objects share the same connection
+  bool operator==(const WiFiClient& other) const {return stream == other.stream;}
+  bool operator!=(const WiFiClient& other) const {return !(stream == other.stream);}
+
+  // with AT 2 the driver has the values from the +LINK_CONN message.
+  // with AT 1 every call to these functions retrieves the value from AT firmware
   IPAddress remoteIP();
   uint16_t remotePort();
   uint16_t localPort();
@@ -84,6 +111,13 @@ private:
   int connect(bool ssl, const char *host, uint16_t port);
 
   WiFiEspAtSharedBuffStreamPtr stream;
+  size_t rxBufferSize = WIFIESPAT_CLIENT_RX_BUFFER_SIZE;
+  size_t txBufferSize = WIFIESPAT_CLIENT_TX_BUFFER_SIZE;
+  uint8_t asyncLinkId = WIFIESPAT_NO_LINK;
+  const WiFiTlsConfig* tlsConfig = nullptr;
+  const WiFiTcpOptions* tcpOptions = nullptr;
+
+  bool attach(uint8_t linkId);
 
 };
 
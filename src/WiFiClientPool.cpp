@@ -0,0 +1,150 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "utility/EspAtDrv.h"
+#include "WiFiClientPool.h"
+
+WiFiClientPool::~WiFiClientPool() {
+  clear();
+}
+
+WiFiClient WiFiClientPool::acquire(const char* host, uint16_t port, bool ssl) {
+  maintain();
+  for (Entry& entry : entries) {
+    if (entry.inUse || !entry.host || entry.port != port || entry.ssl != ssl || strcmp(entry.host, host))
+      continue;
+    // connected() processes the pending CLOSED messages
+    if (entry.client.connected() && !entry.client.available()) {
+      entry.inUse = true;
+      EspAtDrv.setLinkIdleTimeout(entry.client.stream->getLinkId(), 0);
+      return entry.client;
+    }
+    entry.client.stop();
+    freeEntry(entry);
+  }
+
+  WiFiClient client;
+  client.setBufferSizes(rxBufferSize, txBufferSize);
+  int res = ssl ? client.connectSSL(host, port) : client.connect(host, port);
+  if (!res && EspAtDrv.getLastErrorCode() == EspAtDrvError::NO_FREE_LINK && closeOldestIdle()) {
+    res = ssl ? client.connectSSL(host, port) : client.connect(host, port);
+  }
+  if (!res)
+    return client;
+
+  for (Entry& entry : entries) {
+    if (entry.host)
+      continue;
+    size_t l = strlen(host) + 1;
+    entry.host = new char[l];
+    if (!entry.host) // client is returned, but not pooled
+      break;
+    memcpy(entry.host, host, l);
+    entry.port = port;
+    entry.ssl = ssl;
+    entry.inUse = true;
+    entry.client = client;
+    break;
+  }
+  return client;
+}
+
+void WiFiClientPool::release(WiFiClient& client) {
+  for (Entry& entry : entries) {
+    if (!entry.inUse || entry.client != client)
+      continue;
+    // a connection with unread data can't be reused for the next request
+    if (entry.client.connected() && !entry.client.available()) {
+      entry.inUse = false;
+      entry.idleSince = millis();
+      // the driver closes the expired link even if the pool's maintain() isn't called
+      EspAtDrv.setLinkIdleTimeout(entry.client.stream->getLinkId(), idleTimeout);
+    } else {
+      entry.client.stop();
+      freeEntry(entry);
+    }
+    client = WiFiClient();
+    return;
+  }
+  client.stop();
+}
+
+void WiFiClientPool::maintain() {
+  for (Entry& entry : entries) {
+    if (!entry.host)
+      continue;
+    if (entry.inUse) {
+      if (!entry.client) { // stopped by the user
+        freeEntry(entry);
+      }
+      continue;
+    }
+    if (millis() - entry.idleSince > idleTimeout || !entry.client.connected() || entry.client.available()) {
+      entry.client.stop();
+      freeEntry(entry);
+    }
+  }
+}
+
+void WiFiClientPool::clear() {
+  for (Entry& entry : entries) {
+    if (!entry.host)
+      continue;
+    entry.client.stop();
+    freeEntry(entry);
+  }
+}
+
+void WiFiClientPool::setBufferSizes(size_t _rxBufferSize, size_t _txBufferSize) {
+  rxBufferSize = _rxBufferSize;
+  txBufferSize = _txBufferSize;
+}
+
+uint8_t WiFiClientPool::idleCount() {
+  uint8_t count = 0;
+  for (Entry& entry : entries) {
+    if (entry.host && !entry.inUse) {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool WiFiClientPool::closeOldestIdle() {
+  Entry* oldest = nullptr;
+  for (Entry& entry : entries) {
+    if (entry.inUse || !entry.host)
+      continue;
+    if (!oldest || (long) (entry.idleSince - oldest->idleSince) < 0) {
+      oldest = &entry;
+    }
+  }
+  if (!oldest)
+    return false;
+  oldest->client.stop();
+  freeEntry(*oldest);
+  return true;
+}
+
+void WiFiClientPool::freeEntry(Entry& entry) {
+  delete[] entry.host;
+  entry.host = nullptr;
+  entry.inUse = false;
+  entry.client = WiFiClient();
+}
@@ -0,0 +1,78 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WIFICLIENTPOOL_H_
+#define _WIFICLIENTPOOL_H_
+
+#include "WiFiClient.h"
+#include "WiFiEspAtConfig.h"
+
+/**
+ * Keeps connections open between requests to the same host:port.
+ * acquire() returns an idle connected client for the destination
+ * or connects a new one. release() returns the client to the pool
+ * if the connection is still open and all received data were read.
+ * Idle connections are closed after the idle timeout to free the link.
+ * The driver closes them in its maintenance, the entry is removed later.
+ */
+class WiFiClientPool {
+public:
+  WiFiClientPool() {}
+  ~WiFiClientPool();
+
+  WiFiClientPool(const WiFiClientPool&) = delete;
+  WiFiClientPool& operator=(const WiFiClientPool&) = delete;
+
+  // returns a not connected client if connecting failed
+  WiFiClient acquire(const char* host, uint16_t port, bool ssl = false);
+
+  // the client object is reset. don't call stop() on a client to keep it in the pool
+  void release(WiFiClient& client);
+
+  // removes the closed idle connections and closes the expired ones
+  void maintain();
+
+  // closes all pooled connections
+  void clear();
+
+  void setIdleTimeout(unsigned long timeout) {idleTimeout = timeout;} // for the next release()
+  void setBufferSizes(size_t rxBufferSize, size_t txBufferSize);
+
+  uint8_t idleCount();
+
+private:
+
+  struct Entry {
+    WiFiClient client;
+    char* host = nullptr;
+    uint16_t port = 0;
+    bool ssl = false;
+    bool inUse = false;
+    unsigned long idleSince = 0;
+  };
+
+  Entry entries[WIFIESPAT_CLIENT_POOL_SIZE];
+  unsigned long idleTimeout = WIFIESPAT_CLIENT_POOL_IDLE_TIMEOUT;
+  size_t rxBufferSize = WIFIESPAT_CLIENT_RX_BUFFER_SIZE;
+  size_t txBufferSize = WIFIESPAT_CLIENT_TX_BUFFER_SIZE;
+
+  bool closeOldestIdle();
+  void freeEntry(Entry& entry);
+};
+
+#endif
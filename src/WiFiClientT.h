@@ -0,0 +1,238 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WIFICLIENTT_H_
+#define _WIFICLIENTT_H_
+
+#include <Client.h>
+#include "WiFiEspAtBuffStream.h"
+#include "WiFiEspAtDnsCache.h"
+#include "utility/EspAtDrv.h"
+
+class WiFiServer;
+
+/**
+ * WiFiClient variant with the buffers inside of the object.
+ * It doesn't use the buffers pool and the shared stream pointer,
+ * so it can't be copied. The connection is closed in destructor.
+ * Use server.accept(client) to accept a connection into this client.
+ */
+template<size_t RX_BUFFER_SIZE, size_t TX_BUFFER_SIZE>
+class WiFiClientT : public Client {
+
+  static_assert(RX_BUFFER_SIZE > 0 && TX_BUFFER_SIZE > 0, "WiFiClientT buffer sizes must be at least 1");
+
+  friend WiFiServer;
+
+public:
+  WiFiClientT() {
+    stream.rxBuffer = rxBuffer;
+    stream.rxBufferSize = RX_BUFFER_SIZE;
+    stream.txBuffer = txBuffer;
+    stream.txBufferSize = TX_BUFFER_SIZE;
+  }
+
+  WiFiClientT(const WiFiClientT&) = delete;
+  WiFiClientT& operator=(const WiFiClientT&) = delete;
+
+  ~WiFiClientT() {
+    stop();
+  }
+
+  virtual int connect(IPAddress ip, uint16_t port) {return connect(false, ip, port);}
+  virtual int connect(const char *host, uint16_t port) {return connect(false, host, port);}
+  int connectSSL(IPAddress ip, uint16_t port) {return connect(true, ip, port);}
+  int connectSSL(const char *host, uint16_t port) {return connect(true, host, port);}
+
+  virtual void stop() {
+    if (!stream.serialId)
+      return;
+    stream.flush();
+    stream.close();
+  }
+
+  void setTlsConfig(const WiFiTlsConfig* config) {
+    tlsConfig = config;
+  }
+
+  void setTcpOptions(const WiFiTcpOptions* options) {
+    tcpOptions = options;
+  }
+
+  void abort() {
+    if (!stream.serialId)
+      return;
+    stream.close(true);
+  }
+
+  virtual size_t write(uint8_t b) {
+    if (!stream.serialId)
+      return 0;
+    return stream.write(b);
+  }
+
+  virtual size_t write(const uint8_t *buf, size_t size) {
+    if (!stream.serialId)
+      return 0;
+    return stream.write(buf, size);
+  }
+
+  virtual void flush() {
+    if (!stream.serialId)
+      return;
+    stream.flush();
+  }
+
+  size_t write(Stream& file) {
+    if (!stream.serialId)
+      return 0;
+    return stream.write(file);
+  }
+
+  size_t write(SendCallbackFnc callback) {
+    if (!stream.serialId)
+      return 0;
+    return stream.write(callback);
+  }
+
+  virtual int available() {
+    if (!stream.serialId)
+      return 0;
+    return stream.available();
+  }
+
+  virtual int read() {
+    if (!stream.serialId)
+      return -1;
+    return stream.read();
+  }
+
+  virtual int read(uint8_t *buf, size_t size) {
+    if (!stream.serialId)
+      return 0;
+    return stream.read(buf, size);
+  }
+
+  virtual int peek() {
+    if (!stream.serialId)
+      return -1;
+    return stream.peek();
+  }
+
+  size_t peekAvailable() {
+    if (!stream.serialId)
+      return 0;
+    return stream.peekAvailable();
+  }
+
+  const char* peekBuffer() {
+    return (const char*) stream.peekBuffer();
+  }
+
+  void peekConsume(size_t size) {
+    stream.peekConsume(size);
+  }
+
+  virtual operator bool() {
+    return stream.serialId != 0;
+  }
+
+  virtual uint8_t connected() {
+    if (!stream.serialId)
+      return false;
+    if (stream.connected() || available()) // like WiFiClient, connected while data are available
+      return true;
+    stream.free();
+    return false;
+  }
+
+  IPAddress remoteIP() {
+    IPAddress ip;
+    uint16_t port = 0;
+    uint16_t lport = 0;
+    if (stream.getLinkId() != NO_LINK) {
+      EspAtDrv.remoteParamsQuery(stream.getLinkId(), ip, port, lport);
+    }
+    return ip;
+  }
+
+  uint16_t remotePort() {
+    IPAddress ip;
+    uint16_t port = 0;
+    uint16_t lport = 0;
+    if (stream.getLinkId() != NO_LINK) {
+      EspAtDrv.remoteParamsQuery(stream.getLinkId(), ip, port, lport);
+    }
+    return port;
+  }
+
+  uint16_t localPort() {
+    if (stream.getLinkId() == NO_LINK)
+      return 0;
+    return EspAtDrv.localPortQuery(stream.getLinkId());
+  }
+
+  using Print::write;
+
+private:
+  WiFiEspAtBuffStream stream;
+  uint8_t rxBuffer[RX_BUFFER_SIZE];
+  uint8_t txBuffer[TX_BUFFER_SIZE];
+  const WiFiTlsConfig* tlsConfig = nullptr;
+  const WiFiTcpOptions* tcpOptions = nullptr;
+
+  int connect(bool ssl, IPAddress ip, uint16_t port) {
+    char s[16];
+    EspAtDrv.ip2str(ip, s);
+    return connect(ssl, s, port);
+  }
+
+  int connect(bool ssl, const char *host, uint16_t port) {
+    stop();
+    char ip[16];
+    bool cached = !ssl && WiFiEspAtDnsCache.resolveForConnect(host, ip);
+    uint8_t linkId = EspAtDrv.connect(ssl ? "SSL" : "TCP", cached ? ip : host, port,
+#ifdef WIFIESPAT1
+        nullptr,
+#endif
+        0, ssl ? tlsConfig : nullptr);
+    if (linkId == NO_LINK) {
+      EspAtDrvError error = EspAtDrv.getLastErrorCode();
+      // the address could be outdated if the connect failed or timed out. not on a local error like NO_FREE_LINK
+      if (cached && (error == EspAtDrvError::AT_ERROR || error == EspAtDrvError::AT_NOT_RESPONDIG)) {
+        WiFiEspAtDnsCache.remove(host);
+      }
+      return false;
+    }
+#ifndef WIFIESPAT1
+    if (tcpOptions) {
+      EspAtDrv.tcpOptions(linkId, *tcpOptions);
+    }
+#endif
+    attach(linkId);
+    return true;
+  }
+
+  void attach(uint8_t linkId) {
+    stream.linkId = linkId;
+    stream.serialId = 1; // not 0 means in use. the stream is not in the pool
+    stream.writeError = 0;
+  }
+};
+
+#endif
@@ -28,8 +28,13 @@ WiFiEspAtBuffManagerClass::WiFiEspAtBuffManagerClass() {
 }
 
 WiFiEspAtBuffStream* WiFiEspAtBuffManagerClass::getBuffStream(uint8_t linkId, size_t rxBufferSize, size_t txBufferSize) {
+  ESPATDRV_LOCK();
+
+  rxBufferSize = sizeClass(rxBufferSize);
+  txBufferSize = sizeClass(txBufferSize);
 
   int freePos = -1;
+  int unusedPos = -1;
 
   for (int i = 0; i < WIFIESPAT_LINKS_COUNT; i++) {
     if (pool[i] == nullptr) {
@@ -53,13 +58,23 @@ WiFiEspAtBuffStream* WiFiEspAtBuffManagerClass::getBuffStream(uint8_t linkId, si
       LOG_INFO_PRINTLN();
       return pool[i];
     }
+    if (unusedPos == -1) {
+      unusedPos = i;
+    }
   }
-  if (freePos == -1) {
+  WiFiEspAtBuffStream *res;
+  if (freePos != -1) {
+    res = new WiFiEspAtBuffStream();
+    pool[freePos] = res;
+  } else if (unusedPos != -1) { // all positions are taken. reuse an unused stream of other size class
+    freePos = unusedPos;
+    res = pool[freePos];
+    deleteBuffers(res);
+  } else {
     LOG_WARN_PRINT_PREFIX();
     LOG_WARN_PRINTLN(F("getBuffStream no free position"));
     return nullptr;
   }
-  WiFiEspAtBuffStream *res = new WiFiEspAtBuffStream();
   if (rxBufferSize) {
     res->rxBuffer = new uint8_t[rxBufferSize];
   }
@@ -70,7 +85,6 @@ WiFiEspAtBuffStream* WiFiEspAtBuffManagerClass::getBuffStream(uint8_t linkId, si
   res->txBufferSize = txBufferSize;
   res->linkId = linkId;
   res->serialId = nextSerialId();
-  pool[freePos] = res;
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("BuffManager new buff.stream id "));
   LOG_INFO_PRINT(serialId);
@@ -88,19 +102,15 @@ WiFiEspAtBuffStream* WiFiEspAtBuffManagerClass::getBuffStream(uint8_t linkId, si
 }
 
 void WiFiEspAtBuffManagerClass::freeUnused() {
+  ESPATDRV_LOCK();
   for (int i = 0; i < WIFIESPAT_LINKS_COUNT; i++) {
     if (pool[i] == nullptr)
       break;
-    if (pool[i]->linkId == WIFIESPAT_NO_LINK) {
+    if (!pool[i]->serialId) { // UDP receive streams are in use with NO_LINK
       LOG_INFO_PRINT_PREFIX();
       LOG_INFO_PRINT(F("BuffManager free tx "));
       LOG_INFO_PRINTLN(pool[i]->txBufferSize);
-      if (pool[i]->rxBuffer != nullptr) {
-        delete pool[i]->rxBuffer;
-      }
-      if (pool[i]->txBuffer != nullptr) {
-        delete pool[i]->txBuffer;
-      }
+      deleteBuffers(pool[i]);
       delete pool[i];
       pool[i] = nullptr;
     }
@@ -116,6 +126,38 @@ void WiFiEspAtBuffManagerClass::freeUnused() {
   }
 }
 
+/**
+ * Sizes are rounded up to a power of two or to the middle between
+ * two powers of two (16, 24, 32, 48, 64, 96, ...), so buffers requested
+ * with slightly different sizes can be reused from the pool.
+ */
+size_t WiFiEspAtBuffManagerClass::sizeClass(size_t size) {
+  if (size <= 16) // small buffers are allocated as requested
+    return size;
+  size_t c = 16;
+  while (c <= ((size_t) -1) / 4) {
+    if (size <= c)
+      return c;
+    if (size <= c + c / 2)
+      return c + c / 2;
+    c *= 2;
+  }
+  return size;
+}
+
+void WiFiEspAtBuffManagerClass::deleteBuffers(WiFiEspAtBuffStream* stream) {
+  if (stream->rxBuffer != nullptr) {
+    delete[] stream->rxBuffer;
+    stream->rxBuffer = nullptr;
+  }
+  if (stream->txBuffer != nullptr) {
+    delete[] stream->txBuffer;
+    stream->txBuffer = nullptr;
+  }
+  stream->rxBufferSize = 0;
+  stream->txBufferSize = 0;
+}
+
 uint8_t WiFiEspAtBuffManagerClass::nextSerialId() {
   while (true) {
     serialId++;
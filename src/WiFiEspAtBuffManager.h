@@ -31,12 +31,16 @@ public:
 
   void freeUnused();
 
+  // rounds the requested size up to the size class used for allocation and matching
+  static size_t sizeClass(size_t size);
+
 private:
 
   WiFiEspAtBuffStream* pool[WIFIESPAT_LINKS_COUNT];
   uint8_t serialId = 0;
 
   uint8_t nextSerialId();
+  void deleteBuffers(WiFiEspAtBuffStream* stream);
 };
 
 extern WiFiEspAtBuffManagerClass WiFiEspAtBuffManager;
@@ -56,6 +56,7 @@ void WiFiEspAtBuffStream::free() {
   rxBufferIndex = 0;
   txBufferLength = 0;
   udpPort = 0;
+  writeError = 0;
 }
 
 void WiFiEspAtBuffStream::close(bool abort) {
@@ -108,14 +109,20 @@ size_t WiFiEspAtBuffStream::write(const uint8_t *data, size_t length) {
 }
 
 void WiFiEspAtBuffStream::flush() {
+  sendBuffer();
+}
+
+bool WiFiEspAtBuffStream::sendBuffer() {
   if (txBufferLength == 0)
-    return;
+    return true;
   size_t res = EspAtDrv.sendData(linkId, txBuffer, txBufferLength, udpHost, udpPort);
-  if (res != txBufferLength) {
+  bool ok = (res == txBufferLength);
+  txBufferLength = 0; // before checkLink(), which can run the incoming callback
+  if (!ok) {
     setWriteError(1);
     checkLink();
   }
-  txBufferLength = 0;
+  return ok;
 }
 
 int WiFiEspAtBuffStream::availableForWrite() {
@@ -126,6 +133,21 @@ int WiFiEspAtBuffStream::availableForWrite() {
   return txBufferSize - txBufferLength;
 }
 
+size_t WiFiEspAtBuffStream::writeUnbuffered(const uint8_t *data, size_t length) {
+  if (linkId == NO_LINK) {
+    setWriteError();
+    return 0;
+  }
+  // data written before must go first. the write error of an earlier failed send doesn't matter here
+  if (!sendBuffer() || length == 0)
+    return 0;
+  size_t res = EspAtDrv.sendData(linkId, data, length, udpHost, udpPort);
+  if (res != length && !checkLink()) {
+    setWriteError();
+  }
+  return res;
+}
+
 size_t WiFiEspAtBuffStream::write(Stream& file) {
   flush();
   size_t res = EspAtDrv.sendData(linkId, file, udpHost, udpPort);
@@ -191,6 +213,20 @@ int WiFiEspAtBuffStream::read(uint8_t* data, size_t size) {
   return l + read(data + l, size - l); // handle the rest of provided buffer
 }
 
+size_t WiFiEspAtBuffStream::peekAvailable() {
+  if (rxBufferIndex == rxBufferLength) {
+    if (!available())
+      return 0;
+    fillRXbuffer();
+  }
+  return rxBufferLength - rxBufferIndex;
+}
+
+void WiFiEspAtBuffStream::peekConsume(size_t size) {
+  size_t l = rxBufferLength - rxBufferIndex;
+  rxBufferIndex += (size < l) ? size : l;
+}
+
 int WiFiEspAtBuffStream::peek() {
   if (!available())
     return -1;
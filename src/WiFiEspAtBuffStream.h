@@ -42,6 +42,7 @@ public:
 
   size_t write(Stream& file);
   size_t write(SendCallbackFnc callback);
+  size_t writeUnbuffered(const uint8_t *buf, size_t size); // sends from the provided buffer
 
   int8_t getWriteError() {return writeError;}
 
@@ -50,12 +51,20 @@ public:
   int read(uint8_t *buf, size_t size);
   int peek();
 
+  // direct access to the received data in the RX buffer without copying
+  size_t peekAvailable(); // fills the RX buffer if it is empty
+  const uint8_t* peekBuffer() {return rxBuffer + rxBufferIndex;}
+  void peekConsume(size_t size);
+
 private:
   friend class WiFiEspAtBuffManagerClass;
   friend class WiFiEspAtSharedBuffStreamPtr;
   friend class WiFiUDP;
+  friend class WiFiPoll;
+  template<size_t, size_t> friend class WiFiClientT;
 
   void fillRXbuffer();
+  bool sendBuffer();
   void setWriteError(int8_t err = -1) {writeError = err;}
   bool checkLink();
 
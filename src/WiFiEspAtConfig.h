@@ -49,6 +49,11 @@
 #warning WiFiClient RX buffer size must be at least 1
 #endif
 
+#if WIFIESPAT_CLIENT_TX_BUFFER_SIZE == 0
+#define WIFIESPAT_CLIENT_TX_BUFFER_SIZE 1
+#warning WiFiClient TX buffer size must be at least 1
+#endif
+
 #ifndef WIFIESPAT_UDP_TX_BUFFER_SIZE
 #if defined(__AVR__) && RAMEND <= 0x8FF
 #define WIFIESPAT_UDP_TX_BUFFER_SIZE 64
@@ -65,4 +70,68 @@
 #endif
 #endif
 
+#ifndef WIFIESPAT_UDP_RX_MAX_SIZE // AT2 parsePacket() enlarges the RX buffer up to this size for a larger message
+#if defined(__AVR__) && RAMEND <= 0x8FF
+#define WIFIESPAT_UDP_RX_MAX_SIZE WIFIESPAT_UDP_RX_BUFFER_SIZE
+#else
+#define WIFIESPAT_UDP_RX_MAX_SIZE 2048
+#endif
+#endif
+
+#ifndef WIFIESPAT_UDP_PACER_QUEUE_SIZE
+#if defined(__AVR__) && RAMEND <= 0x8FF
+#define WIFIESPAT_UDP_PACER_QUEUE_SIZE 128
+#else
+#define WIFIESPAT_UDP_PACER_QUEUE_SIZE 512
+#endif
+#endif
+
+#ifndef WIFIESPAT_CLIENT_POOL_SIZE
+#if defined(__AVR__) && RAMEND <= 0x8FF
+#define WIFIESPAT_CLIENT_POOL_SIZE 1
+#else
+#define WIFIESPAT_CLIENT_POOL_SIZE 2
+#endif
+#endif
+
+#ifndef WIFIESPAT_CLIENT_POOL_IDLE_TIMEOUT
+#define WIFIESPAT_CLIENT_POOL_IDLE_TIMEOUT 30000
+#endif
+
+#ifndef WIFIESPAT_DNS_CACHE_SIZE
+#if defined(__AVR__) && RAMEND <= 0x8FF
+#define WIFIESPAT_DNS_CACHE_SIZE 1
+#else
+#define WIFIESPAT_DNS_CACHE_SIZE 4
+#endif
+#endif
+
+#ifndef WIFIESPAT_DNS_CACHE_TTL
+#define WIFIESPAT_DNS_CACHE_TTL 300000
+#endif
+
+#ifndef WIFIESPAT_DNS_CACHE_NEGATIVE_TTL
+#define WIFIESPAT_DNS_CACHE_NEGATIVE_TTL 10000
+#endif
+
+#ifndef WIFIESPAT_CONN_MANAGER_NETWORKS
+#define WIFIESPAT_CONN_MANAGER_NETWORKS 3
+#endif
+
+#ifndef WIFIESPAT_CONN_MANAGER_MIN_DELAY
+#define WIFIESPAT_CONN_MANAGER_MIN_DELAY 1000
+#endif
+
+#ifndef WIFIESPAT_CONN_MANAGER_MAX_DELAY
+#define WIFIESPAT_CONN_MANAGER_MAX_DELAY 60000
+#endif
+
+#ifndef WIFIESPAT_TIME_SYNC_INTERVAL
+#define WIFIESPAT_TIME_SYNC_INTERVAL 3600000
+#endif
+
+#ifndef WIFIESPAT_POLL_SIZE
+#define WIFIESPAT_POLL_SIZE 6 // all 5 links and a server
+#endif
+
 #endif
@@ -0,0 +1,223 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "WiFiEspAtConnManager.h"
+#include "utility/EspAtDrvLogging.h"
+#include "utility/EspAtDrv.h"
+
+bool WiFiEspAtConnManagerClass::addNetwork(const char* ssid, const char* passphrase) {
+  if (networkCount == WIFIESPAT_CONN_MANAGER_NETWORKS)
+    return false;
+  Network& n = networks[networkCount++];
+  n.ssid = ssid;
+  n.passphrase = passphrase;
+  n.rssi = -128;
+  n.tried = false;
+  return true;
+}
+
+void WiFiEspAtConnManagerClass::clearNetworks() {
+  end();
+  networkCount = 0;
+}
+
+void WiFiEspAtConnManagerClass::begin() {
+  if (state != STATE_STOPPED || !networkCount)
+    return;
+  retryDelay = 0;
+  downSince = millis();
+  waitStart = millis();
+  connectedNetwork = -1;
+  joiningNetwork = -1;
+  state = STATE_WAIT;
+  int status = EspAtDrv.staStatus();
+  if (status >= 2 && status <= 4) { // already connected (auto-connect of the AT firmware)
+    connectedEvent(-1);
+  }
+  EspAtDrv.setMaintainCallback(maintainCallback);
+  run();
+}
+
+void WiFiEspAtConnManagerClass::end() {
+  if (state == STATE_STOPPED)
+    return;
+  EspAtDrv.setMaintainCallback(nullptr);
+  if (state == STATE_JOIN) {
+    EspAtDrv.joinAPAsyncCancel();
+  }
+  state = STATE_STOPPED;
+  connectedNetwork = -1;
+}
+
+void WiFiEspAtConnManagerClass::setBackoff(unsigned long _minDelay, unsigned long _maxDelay) {
+  minDelay = _minDelay;
+  maxDelay = (_maxDelay > _minDelay) ? _maxDelay : _minDelay;
+}
+
+int8_t WiFiEspAtConnManagerClass::lastRssi(uint8_t network) {
+  if (network >= networkCount)
+    return -128;
+  return networks[network].rssi;
+}
+
+void WiFiEspAtConnManagerClass::run() {
+  run(true);
+}
+
+/**
+ * With idle false it only follows the state, because the calling function
+ * sends a command next. A scan or join is started only by an idle run.
+ */
+void WiFiEspAtConnManagerClass::run(bool idle) {
+  if (running) // run() -> EspAtDrv function -> maintain() -> run()
+    return;
+  running = true;
+  switch (state) {
+    case STATE_STOPPED:
+      break;
+    case STATE_CONNECTED:
+      if (EspAtDrv.staState() == ESPAT_STA_DISCONNECTED) {
+        LOG_INFO_PRINT_PREFIX();
+        LOG_INFO_PRINTLN(F("conn manager: disconnected"));
+        downSince = millis();
+        waitStart = millis();
+        retryDelay = 0; // the first attempt without delay
+        int8_t network = connectedNetwork;
+        connectedNetwork = -1;
+        state = STATE_WAIT;
+        event(WIFI_CONN_DISCONNECTED, network, 0);
+      }
+      break;
+    case STATE_WAIT:
+      if (EspAtDrv.staState() == ESPAT_STA_GOT_IP) { // connected by the AT firmware or by the sketch
+        connectedEvent(joiningNetwork);
+        break;
+      }
+      if (!idle || millis() - waitStart < retryDelay)
+        break;
+      if (networkCount > 1) {
+        for (uint8_t i = 0; i < networkCount; i++) {
+          networks[i].rssi = -128;
+        }
+        if (EspAtDrv.scanAsync(scanCallback)) {
+          state = STATE_SCAN;
+          break;
+        }
+      }
+      join();
+      break;
+    case STATE_SCAN:
+      if (!idle || EspAtDrv.scanAsyncStatus() == ESPAT_SCAN_RUNNING)
+        break;
+      join();
+      break;
+    case STATE_JOIN:
+      switch (EspAtDrv.joinAPAsyncStatus()) {
+        case ESPAT_CONNECT_PENDING:
+          break;
+        case ESPAT_CONNECT_SUCCESS:
+          connectedEvent(joiningNetwork);
+          break;
+        case ESPAT_CONNECT_FAILED:
+          joinFailed();
+          break;
+      }
+      break;
+  }
+  running = false;
+}
+
+void WiFiEspAtConnManagerClass::connectedEvent(int8_t network) {
+  reconnectTime = millis() - downSince;
+  reconnects++;
+  retryDelay = 0;
+  connectedNetwork = network;
+  for (uint8_t i = 0; i < networkCount; i++) {
+    networks[i].tried = false;
+  }
+  state = STATE_CONNECTED;
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("conn manager: connected in "));
+  LOG_INFO_PRINTLN(reconnectTime);
+  event(WIFI_CONN_CONNECTED, network, reconnectTime);
+}
+
+/**
+ * Joins the strongest network not yet tried since the last connection.
+ * The networks not seen in the scan are tried last (maybe a hidden SSID).
+ */
+void WiFiEspAtConnManagerClass::join() {
+  int8_t best = -1;
+  for (uint8_t round = 0; round < 2 && best == -1; round++) {
+    for (uint8_t i = 0; i < networkCount; i++) {
+      if (networks[i].tried)
+        continue;
+      if (best == -1 || networks[i].rssi > networks[best].rssi) {
+        best = i;
+      }
+    }
+    if (best == -1) { // all were tried. next round
+      for (uint8_t i = 0; i < networkCount; i++) {
+        networks[i].tried = false;
+      }
+    }
+  }
+  Network& n = networks[best];
+  n.tried = true;
+  joiningNetwork = best;
+  if (EspAtDrv.joinAPAsync(n.ssid, n.passphrase)) {
+    state = STATE_JOIN;
+  } else {
+    joinFailed();
+  }
+}
+
+void WiFiEspAtConnManagerClass::joinFailed() {
+  retryDelay = retryDelay ? retryDelay * 2 : minDelay;
+  if (retryDelay > maxDelay) {
+    retryDelay = maxDelay;
+  }
+  LOG_WARN_PRINT_PREFIX();
+  LOG_WARN_PRINT(F("conn manager: join failed. retry in "));
+  LOG_WARN_PRINTLN(retryDelay);
+  waitStart = millis();
+  state = STATE_WAIT;
+  event(WIFI_CONN_FAILED, joiningNetwork, retryDelay);
+}
+
+void WiFiEspAtConnManagerClass::event(WiFiConnEvent event, int8_t network, unsigned long time) {
+  if (eventCallback) {
+    eventCallback(event, network, time);
+  }
+}
+
+void WiFiEspAtConnManagerClass::maintainCallback(bool idle) {
+  WiFiEspAtConnManager.run(idle);
+}
+
+void WiFiEspAtConnManagerClass::scanCallback(const WiFiApData& ap) {
+  WiFiEspAtConnManagerClass& m = WiFiEspAtConnManager;
+  for (uint8_t i = 0; i < m.networkCount; i++) {
+    if (!strcmp(m.networks[i].ssid, ap.ssid) && ap.rssi > m.networks[i].rssi) {
+      m.networks[i].rssi = ap.rssi;
+    }
+  }
+}
+
+WiFiEspAtConnManagerClass WiFiEspAtConnManager;
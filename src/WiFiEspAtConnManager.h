@@ -0,0 +1,108 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WIFIESPAT_CONN_MANAGER_H_
+#define _WIFIESPAT_CONN_MANAGER_H_
+
+#include "utility/EspAtDrvTypes.h"
+#include "WiFiEspAtConfig.h"
+
+enum WiFiConnEvent {
+  WIFI_CONN_CONNECTED, // the time parameter is the downtime since disconnect or begin()
+  WIFI_CONN_DISCONNECTED,
+  WIFI_CONN_FAILED // the time parameter is the delay before the next attempt
+};
+
+typedef void (*WiFiConnEventCallback)(WiFiConnEvent event, int8_t network, unsigned long time);
+
+/**
+ * Keeps the STA connected to one of the configured networks.
+ * It runs from the networking functions of the library or from run().
+ * The scan and the join (AT+CWJAP) are started only from run() or from
+ * functions which don't send a command (status(), available(), connected()).
+ * They are sent without waiting for the result, but the other commands
+ * wait until they are finished.
+ * With more networks, a scan before the join finds the network with
+ * the strongest signal. After a failed join the next attempt is delayed
+ * with exponential backoff.
+ * The ssid and passphrase strings must be valid while the manager runs.
+ */
+class WiFiEspAtConnManagerClass {
+public:
+
+  bool addNetwork(const char* ssid, const char* passphrase = nullptr);
+  void clearNetworks();
+
+  void begin(); // starts connecting if the STA is not connected
+  void end(); // a pending join is cancelled
+  void run();
+
+  void setBackoff(unsigned long minDelay, unsigned long maxDelay);
+  void onEvent(WiFiConnEventCallback callback) {eventCallback = callback;}
+
+  bool connected() {return state == STATE_CONNECTED;}
+  int8_t network() {return connectedNetwork;} // index of the connected network or -1
+  int8_t lastRssi(uint8_t network); // from the last scan. -128 if not seen
+  unsigned long lastReconnectTime() {return reconnectTime;}
+  unsigned long reconnectCount() {return reconnects;}
+
+private:
+
+  enum State {
+    STATE_STOPPED,
+    STATE_CONNECTED,
+    STATE_WAIT,
+    STATE_SCAN,
+    STATE_JOIN
+  };
+
+  struct Network {
+    const char* ssid = nullptr;
+    const char* passphrase = nullptr;
+    int8_t rssi = -128;
+    bool tried = false;
+  };
+
+  Network networks[WIFIESPAT_CONN_MANAGER_NETWORKS];
+  uint8_t networkCount = 0;
+  State state = STATE_STOPPED;
+  int8_t connectedNetwork = -1;
+  int8_t joiningNetwork = -1;
+  unsigned long minDelay = WIFIESPAT_CONN_MANAGER_MIN_DELAY;
+  unsigned long maxDelay = WIFIESPAT_CONN_MANAGER_MAX_DELAY;
+  unsigned long retryDelay = 0;
+  unsigned long waitStart = 0;
+  unsigned long downSince = 0;
+  unsigned long reconnectTime = 0;
+  unsigned long reconnects = 0;
+  WiFiConnEventCallback eventCallback = nullptr;
+  bool running = false;
+
+  void run(bool idle);
+  void connectedEvent(int8_t network);
+  void join();
+  void joinFailed();
+  void event(WiFiConnEvent event, int8_t network, unsigned long time);
+
+  static void maintainCallback(bool idle);
+  static void scanCallback(const WiFiApData& ap);
+};
+
+extern WiFiEspAtConnManagerClass WiFiEspAtConnManager;
+
+#endif
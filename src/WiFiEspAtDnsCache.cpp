@@ -0,0 +1,121 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "WiFiEspAtDnsCache.h"
+#include "utility/EspAtDrvLogging.h"
+#include "utility/EspAtDrv.h"
+
+bool WiFiEspAtDnsCacheClass::resolve(const char* hostname, IPAddress& result) {
+  ESPATDRV_LOCK();
+  if (result.fromString(hostname)) // an IP address in text form
+    return true;
+
+  Entry* entry = find(hostname);
+  if (entry) {
+    hitCount++;
+    if (entry->ip == IPAddress(0, 0, 0, 0))
+      return false;
+    result = entry->ip;
+    return true;
+  }
+  missCount++;
+
+  if (EspAtDrv.resolve(hostname, result)) {
+    store(hostname, result);
+    return true;
+  }
+  // only an ERROR of AT+CIPDOMAIN is the DNS answer
+  if (EspAtDrv.getLastErrorCode() == EspAtDrvError::AT_ERROR) {
+    store(hostname, IPAddress(0, 0, 0, 0));
+  }
+  return false;
+}
+
+bool WiFiEspAtDnsCacheClass::resolveForConnect(const char* hostname, char* ipStr) {
+  if (!useForConnect)
+    return false;
+  IPAddress ip;
+  if (!resolve(hostname, ip))
+    return false; // let the firmware report the error
+  EspAtDrv.ip2str(ip, ipStr);
+  return true;
+}
+
+void WiFiEspAtDnsCacheClass::remove(const char* hostname) {
+  ESPATDRV_LOCK();
+  for (Entry& entry : entries) {
+    if (entry.hostname && !strcmp(entry.hostname, hostname)) {
+      freeEntry(entry);
+    }
+  }
+}
+
+void WiFiEspAtDnsCacheClass::clear() {
+  ESPATDRV_LOCK();
+  for (Entry& entry : entries) {
+    freeEntry(entry);
+  }
+}
+
+WiFiEspAtDnsCacheClass::Entry* WiFiEspAtDnsCacheClass::find(const char* hostname) {
+  for (Entry& entry : entries) {
+    if (!entry.hostname || strcmp(entry.hostname, hostname))
+      continue;
+    unsigned long entryTTL = (entry.ip == IPAddress(0, 0, 0, 0)) ? negativeTTL : ttl;
+    if (millis() - entry.time < entryTTL)
+      return &entry;
+    freeEntry(entry);
+    return nullptr;
+  }
+  return nullptr;
+}
+
+void WiFiEspAtDnsCacheClass::store(const char* hostname, const IPAddress& ip) {
+  Entry* slot = nullptr;
+  for (Entry& entry : entries) {
+    if (!entry.hostname) {
+      slot = &entry;
+      break;
+    }
+    if (!slot || (long) (entry.time - slot->time) < 0) { // replace the oldest
+      slot = &entry;
+    }
+  }
+  if (!slot)
+    return;
+  freeEntry(*slot);
+  size_t l = strlen(hostname) + 1;
+  slot->hostname = new char[l];
+  if (!slot->hostname)
+    return;
+  memcpy(slot->hostname, hostname, l);
+  slot->ip = ip;
+  slot->time = millis();
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("DNS cache stored "));
+  LOG_INFO_PRINTLN(hostname);
+}
+
+void WiFiEspAtDnsCacheClass::freeEntry(Entry& entry) {
+  delete[] entry.hostname;
+  entry.hostname = nullptr;
+}
+
+WiFiEspAtDnsCacheClass WiFiEspAtDnsCache;
@@ -0,0 +1,72 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ESP_AT_DNS_CACHE_H_
+#define _ESP_AT_DNS_CACHE_H_
+
+#include <IPAddress.h>
+#include "WiFiEspAtConfig.h"
+
+/**
+ * Remembers the results of AT+CIPDOMAIN. The AT firmware doesn't report
+ * the TTL of the DNS record, so entries expire after a configured time.
+ * A failed lookup is remembered for a shorter time (negative caching).
+ */
+class WiFiEspAtDnsCacheClass {
+public:
+
+  bool resolve(const char* hostname, IPAddress& result);
+
+  // fills ipStr (16 chars) if the hostname should be replaced in AT+CIPSTART
+  bool resolveForConnect(const char* hostname, char* ipStr);
+
+  void remove(const char* hostname);
+  void clear();
+
+  void setTTL(unsigned long ttl) {this->ttl = ttl;}
+  void setNegativeTTL(unsigned long ttl) {negativeTTL = ttl;}
+
+  // connect(host) of WiFiClient resolves with the cache. not used for SSL (SNI)
+  void setUseForConnect(bool use) {useForConnect = use;}
+
+  unsigned long hits() {return hitCount;}
+  unsigned long misses() {return missCount;}
+
+private:
+
+  struct Entry {
+    char* hostname = nullptr;
+    IPAddress ip; // 0.0.0.0 for a failed lookup
+    unsigned long time = 0;
+  };
+
+  Entry entries[WIFIESPAT_DNS_CACHE_SIZE];
+  unsigned long ttl = WIFIESPAT_DNS_CACHE_TTL;
+  unsigned long negativeTTL = WIFIESPAT_DNS_CACHE_NEGATIVE_TTL;
+  bool useForConnect = false;
+  unsigned long hitCount = 0;
+  unsigned long missCount = 0;
+
+  Entry* find(const char* hostname);
+  void store(const char* hostname, const IPAddress& ip);
+  void freeEntry(Entry& entry);
+};
+
+extern WiFiEspAtDnsCacheClass WiFiEspAtDnsCache;
+
+#endif
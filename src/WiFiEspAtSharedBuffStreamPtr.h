@@ -21,6 +21,7 @@
 #define _ESP_AT_BUFF_PTR_H_
 
 #include "WiFiEspAtBuffStream.h"
+#include "utility/EspAtDrvLock.h"
 
 class WiFiEspAtSharedBuffStreamPtr {
 public:
@@ -81,6 +82,10 @@ public:
     return (ptr != nullptr && serialId == ptr->serialId);
   }
 
+  bool operator==(const WiFiEspAtSharedBuffStreamPtr& other) const {
+    return (ptr == other.ptr && serialId == other.serialId);
+  }
+
 private:
   WiFiEspAtBuffStream* ptr = nullptr;
   uint8_t serialId = 0;
@@ -93,11 +98,13 @@ private:
   }
 
   void increaseRefCount() {
+    ESPATDRV_LOCK();
     if (checkValid()) {
       ptr->refCount++;
     }
   }
   void decreaseRefCount() {
+    ESPATDRV_LOCK();
     if (checkValid()) {
       ptr->refCount--;
       if (ptr->refCount == 0) {
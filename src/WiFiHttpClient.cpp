@@ -0,0 +1,191 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include "WiFiHttpClient.h"
+
+bool WiFiHttpClient::sendRequest(const char* method, const char* host, const char* path,
+    const char* contentType, const uint8_t* body, size_t length, const char* headers) {
+  headRequest = !strcmp(method, "HEAD");
+  client.print(method);
+  client.print(' ');
+  client.print(path);
+  client.print(F(" HTTP/1.1\r\nHost: "));
+  client.print(host);
+  client.print(F("\r\n"));
+  if (contentType) {
+    client.print(F("Content-Type: "));
+    client.print(contentType);
+    client.print(F("\r\n"));
+  }
+  if (body || length) {
+    client.print(F("Content-Length: "));
+    client.print(length);
+    client.print(F("\r\n"));
+  }
+  if (headers) {
+    client.print(headers);
+  }
+  client.print(F("Connection: keep-alive\r\n\r\n"));
+  size_t written = length ? client.write(body, length) : 0;
+  client.flush();
+  return (written == length) && client.connected();
+}
+
+int WiFiHttpClient::readResponse(HttpBodyCallbackFnc bodyCallback, unsigned long timeout) {
+  state = STATUS_LINE;
+  status = 0;
+  length = -1;
+  chunked = false;
+  closeAfter = false;
+  complete = false;
+  lineLength = 0;
+
+  unsigned long lastData = millis();
+  while (state != DONE) {
+    size_t size = client.peekAvailable();
+    if (size == 0) {
+      if (!client.connected()) {
+        if (state == BODY && length == -1 && !chunked) // body without length ends with close
+          break;
+        return WIFIHTTP_ERROR_CONNECTION;
+      }
+      if (millis() - lastData > timeout)
+        return WIFIHTTP_ERROR_TIMEOUT;
+      continue;
+    }
+    lastData = millis();
+    size_t used = parse((const uint8_t*) client.peekBuffer(), size, bodyCallback);
+    client.peekConsume(used);
+    if (state == FAILED)
+      return WIFIHTTP_ERROR_PROTOCOL;
+  }
+  complete = true;
+  return status;
+}
+
+size_t WiFiHttpClient::parse(const uint8_t* data, size_t size, HttpBodyCallbackFnc bodyCallback) {
+  size_t i = 0;
+  while (i < size && state != DONE && state != FAILED) {
+    if (state == BODY) {
+      size_t l = size - i;
+      if (remaining >= 0 && (long) l > remaining) {
+        l = remaining;
+      }
+      if (bodyCallback) {
+        bodyCallback(data + i, l);
+      }
+      i += l;
+      if (remaining >= 0) {
+        remaining -= l;
+        if (remaining == 0) {
+          state = chunked ? CHUNK_END : DONE;
+        }
+      }
+      continue;
+    }
+    char c = data[i++];
+    if (c == '\n') {
+      line[lineLength] = 0;
+      processLine();
+      lineLength = 0;
+    } else if (c != '\r' && lineLength < LINE_SIZE - 1) {
+      line[lineLength++] = c;
+    }
+  }
+  return i;
+}
+
+void WiFiHttpClient::processLine() {
+  switch (state) {
+    case STATUS_LINE:
+      if (strncmp(line, "HTTP/1.", 7) || lineLength < 12) {
+        state = FAILED;
+        return;
+      }
+      closeAfter = (line[7] == '0'); // HTTP/1.0 closes by default
+      status = atoi(line + 9);
+      state = HEADERS;
+      break;
+    case HEADERS:
+      if (lineLength) {
+        processHeader();
+      } else {
+        headersEnd();
+      }
+      break;
+    case CHUNK_SIZE:
+      remaining = strtol(line, nullptr, 16); // chunk extensions after ';' are ignored
+      state = remaining ? BODY : TRAILER;
+      break;
+    case CHUNK_END: // CRLF after chunk data
+      state = CHUNK_SIZE;
+      break;
+    case TRAILER:
+      if (!lineLength) {
+        state = DONE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void WiFiHttpClient::processHeader() {
+  char* value = strchr(line, ':');
+  if (!value)
+    return;
+  *value++ = 0;
+  while (*value == ' ') {
+    value++;
+  }
+  if (!strcasecmp(line, "Content-Length")) {
+    length = atol(value);
+  } else if (!strcasecmp(line, "Transfer-Encoding")) {
+    size_t l = strlen(value);
+    chunked = (l >= 7 && !strcasecmp(value + l - 7, "chunked")); // chunked is always the last encoding
+  } else if (!strcasecmp(line, "Connection")) {
+    if (!strcasecmp(value, "close")) {
+      closeAfter = true;
+    } else if (!strcasecmp(value, "keep-alive")) {
+      closeAfter = false;
+    }
+  }
+  if (headerCallback) {
+    headerCallback(line, value);
+  }
+}
+
+void WiFiHttpClient::headersEnd() {
+  if (status < 200) { // 100 Continue. the final response follows
+    state = STATUS_LINE;
+    return;
+  }
+  if (headRequest || status == 204 || status == 304) {
+    state = DONE;
+  } else if (chunked) {
+    state = CHUNK_SIZE;
+  } else if (length >= 0) {
+    remaining = length;
+    state = length ? BODY : DONE;
+  } else { // the body ends with closing of the connection
+    remaining = -1;
+    closeAfter = true;
+    state = BODY;
+  }
+}
@@ -0,0 +1,92 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WIFIHTTPCLIENT_H_
+#define _WIFIHTTPCLIENT_H_
+
+#include "WiFiClient.h"
+
+const int WIFIHTTP_ERROR_CONNECTION = -1;
+const int WIFIHTTP_ERROR_TIMEOUT = -2;
+const int WIFIHTTP_ERROR_PROTOCOL = -3;
+
+typedef void (*HttpBodyCallbackFnc)(const uint8_t* data, size_t length);
+typedef void (*HttpHeaderCallbackFnc)(const char* name, const char* value);
+
+/**
+ * HTTP/1.1 client working on a connected WiFiClient.
+ * The response is parsed directly in the RX buffer of the client.
+ * The body is handed to the callback in the pieces as they are in the buffer,
+ * chunked transfer encoding is removed. Header lines longer than
+ * the line buffer are truncated.
+ * If keepAlive() returns true after the response, the connection
+ * can be used for the next request (see WiFiClientPool).
+ */
+class WiFiHttpClient {
+public:
+  WiFiHttpClient(WiFiClient& client) : client(client) {}
+
+  // headers are additional header lines, each terminated with "\r\n"
+  bool sendRequest(const char* method, const char* host, const char* path,
+      const char* contentType = nullptr, const uint8_t* body = nullptr, size_t length = 0,
+      const char* headers = nullptr);
+
+  // returns the HTTP status code or a negative WIFIHTTP_ERROR. timeout is for inactivity
+  int readResponse(HttpBodyCallbackFnc bodyCallback, unsigned long timeout = 10000);
+
+  void setHeaderCallback(HttpHeaderCallbackFnc callback) {headerCallback = callback;}
+
+  int statusCode() {return status;}
+  long contentLength() {return length;} // -1 if not sent by the server
+  bool keepAlive() {return complete && !closeAfter;}
+
+private:
+  static const uint8_t LINE_SIZE = 64;
+
+  enum ParserState {
+    STATUS_LINE,
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK_END,
+    TRAILER,
+    DONE,
+    FAILED
+  };
+
+  WiFiClient& client;
+  HttpHeaderCallbackFnc headerCallback = nullptr;
+  bool headRequest = false;
+
+  ParserState state = DONE;
+  int status = 0;
+  long length = -1;
+  long remaining = 0;
+  bool chunked = false;
+  bool closeAfter = false;
+  bool complete = false;
+  char line[LINE_SIZE];
+  uint8_t lineLength = 0;
+
+  size_t parse(const uint8_t* data, size_t size, HttpBodyCallbackFnc bodyCallback);
+  void processLine();
+  void processHeader();
+  void headersEnd();
+};
+
+#endif
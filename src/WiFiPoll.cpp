@@ -0,0 +1,145 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "utility/EspAtDrv.h"
+#include "WiFiPoll.h"
+
+bool WiFiPoll::add(WiFiClient& client, uint8_t events) {
+  return add(&client, TYPE_CLIENT, events);
+}
+
+bool WiFiPoll::add(WiFiServer& server) {
+  return add(&server, TYPE_SERVER, WIFIPOLL_ACCEPTABLE);
+}
+
+bool WiFiPoll::add(WiFiUDP& udp) {
+  return add(&udp, TYPE_UDP, WIFIPOLL_READABLE);
+}
+
+bool WiFiPoll::add(void* object, Type type, uint8_t events) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (entries[i].object == object) { // update the interest
+      entries[i].events = events;
+      return true;
+    }
+  }
+  if (count == WIFIESPAT_POLL_SIZE)
+    return false;
+  Entry& entry = entries[count++];
+  entry.object = object;
+  entry.type = type;
+  entry.events = events;
+  entry.revents = 0;
+  return true;
+}
+
+void WiFiPoll::remove(const void* object) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (entries[i].object != object)
+      continue;
+    count--;
+    for (; i < count; i++) {
+      entries[i] = entries[i + 1];
+    }
+    return;
+  }
+}
+
+uint8_t WiFiPoll::ready(const void* object) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (entries[i].object == object)
+      return entries[i].revents;
+  }
+  return 0;
+}
+
+uint8_t WiFiPoll::poll(unsigned long timeout) {
+  unsigned long start = millis();
+  while (true) {
+    EspAtDrv.pollSync(false);
+    uint8_t res = check();
+    if (res)
+      return res;
+    EspAtDrv.pollSync(true);
+    res = check();
+    if (res || millis() - start >= timeout)
+      return res;
+    yield();
+  }
+}
+
+uint8_t WiFiPoll::check() {
+  uint8_t res = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    Entry& entry = entries[i];
+    switch (entry.type) {
+      case TYPE_CLIENT:
+        entry.revents = checkClient(*((WiFiClient*) entry.object));
+        break;
+      case TYPE_SERVER:
+        entry.revents = checkServer(*((WiFiServer*) entry.object));
+        break;
+      case TYPE_UDP:
+        entry.revents = checkUdp(*((WiFiUDP*) entry.object));
+        break;
+    }
+    entry.revents &= entry.events;
+    if (entry.revents) {
+      res++;
+    }
+  }
+  return res;
+}
+
+uint8_t WiFiPoll::checkClient(WiFiClient& client) {
+  if (client.asyncLinkId != NO_LINK)
+    return 0;
+  if (!client.stream)
+    return WIFIPOLL_CLOSED;
+  uint8_t res = 0;
+  if (client.stream->rxBufferIndex < client.stream->rxBufferLength) {
+    res |= WIFIPOLL_READABLE;
+  }
+  bool connected = false;
+  if (EspAtDrv.pollLink(client.stream->linkId, connected)) {
+    res |= WIFIPOLL_READABLE;
+  }
+  if (!connected) {
+    res |= WIFIPOLL_CLOSED;
+  }
+  return res;
+}
+
+uint8_t WiFiPoll::checkServer(WiFiServer& server) {
+  if (server.state == CLOSED || !EspAtDrv.pollIncoming(server.port))
+    return 0;
+  return WIFIPOLL_ACCEPTABLE;
+}
+
+uint8_t WiFiPoll::checkUdp(WiFiUDP& udp) {
+#ifdef WIFIESPAT1
+  // AT 1 delivers the datagram into rxStream. not yet parsed if nothing was read
+  if (udp.rxStream && udp.rxStream->rxBufferIndex == 0 && udp.rxStream->rxBufferLength > 0)
+    return WIFIPOLL_READABLE;
+#else
+  bool connected;
+  if (udp.linkId != NO_LINK && EspAtDrv.pollLink(udp.linkId, connected))
+    return WIFIPOLL_READABLE;
+#endif
+  return 0;
+}
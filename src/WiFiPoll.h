@@ -0,0 +1,77 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WIFIPOLL_H_
+#define _WIFIPOLL_H_
+
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "WiFiUdp.h"
+#include "WiFiEspAtConfig.h"
+
+const uint8_t WIFIPOLL_READABLE = (1 << 0); // client or UDP has received data
+const uint8_t WIFIPOLL_ACCEPTABLE = (1 << 1); // server has a connection to accept
+const uint8_t WIFIPOLL_CLOSED = (1 << 2); // client's connection is closed
+
+/**
+ * Waits for any of a set of clients, servers and UDP objects to be ready.
+ * One pass evaluates the state the driver has from the received messages
+ * (+IPD, CONNECT, CLOSED) and only if nothing is ready it syncs
+ * the state of all links with one AT+CIPRECVLEN? query (throttled by the driver).
+ * The added objects must exist while they are in the set.
+ * A not connected client is reported as closed, but a client
+ * connecting with connectAsync is not reported until connected.
+ */
+class WiFiPoll {
+public:
+
+  bool add(WiFiClient& client, uint8_t events = WIFIPOLL_READABLE | WIFIPOLL_CLOSED);
+  bool add(WiFiServer& server);
+  bool add(WiFiUDP& udp);
+  void remove(const void* object);
+  void clear() {count = 0;}
+
+  // returns the count of ready objects. timeout 0 is one pass
+  uint8_t poll(unsigned long timeout = 0);
+
+  // the events found by the last poll()
+  uint8_t ready(const void* object);
+
+  uint8_t size() {return count;}
+
+private:
+  enum Type : uint8_t {TYPE_CLIENT, TYPE_SERVER, TYPE_UDP};
+
+  struct Entry {
+    void* object;
+    Type type;
+    uint8_t events;
+    uint8_t revents;
+  };
+
+  Entry entries[WIFIESPAT_POLL_SIZE];
+  uint8_t count = 0;
+
+  bool add(void* object, Type type, uint8_t events);
+  uint8_t check();
+  uint8_t checkClient(WiFiClient& client);
+  uint8_t checkServer(WiFiServer& server);
+  uint8_t checkUdp(WiFiUDP& udp);
+};
+
+#endif
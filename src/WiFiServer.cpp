@@ -20,11 +20,17 @@
 #include "utility/EspAtDrv.h"
 #include "WiFiServer.h"
 
+WiFiServer* WiFiServer::callbackServers = nullptr;
+
 WiFiServer::WiFiServer(uint16_t _port) {
   port = _port;
   state = CLOSED;
 }
 
+WiFiServer::~WiFiServer() {
+  onClient(nullptr);
+}
+
 void WiFiServer::begin(uint8_t maxConnCount, uint16_t serverTimeout) {
 	end();
   state = EspAtDrv.serverBegin(port, maxConnCount, serverTimeout) ? LISTEN : CLOSED;
@@ -64,14 +70,74 @@ WiFiClient WiFiServer::available() {
 }
 
 WiFiClient WiFiServer::accept() {
-  if (state != CLOSED) {
-    uint8_t linkId = EspAtDrv.newClientLinkId(port);
-    if (linkId != NO_LINK)
-      return WiFiClient(linkId);
-  }
+  uint8_t linkId = acceptLinkId();
+  if (linkId != NO_LINK)
+    return WiFiClient(linkId, clientRxBufferSize, clientTxBufferSize);
   return WiFiClient();
 }
 
+uint8_t WiFiServer::acceptLinkId() {
+  if (state == CLOSED)
+    return NO_LINK;
+  uint8_t linkId = EspAtDrv.newClientLinkId(port);
+#ifndef WIFIESPAT1
+  if (linkId != NO_LINK && clientTcpOptions) {
+    EspAtDrv.tcpOptions(linkId, *clientTcpOptions);
+  }
+#endif
+  return linkId;
+}
+
+void WiFiServer::onClient(ServerClientCallbackFnc callback) {
+  WiFiServer** p = &callbackServers;
+  while (*p && *p != this) {
+    p = &(*p)->nextCallbackServer;
+  }
+  if (callback && !*p) { // register
+    *p = this;
+    nextCallbackServer = nullptr;
+  } else if (!callback && *p) { // unregister
+    *p = nextCallbackServer;
+  }
+  clientCallback = callback;
+  EspAtDrv.setIncomingCallback(callbackServers ? dispatchClients : nullptr);
+}
+
+void WiFiServer::dispatchClients() {
+  for (WiFiServer* server = callbackServers; server; server = server->nextCallbackServer) {
+    while (true) {
+      WiFiClient client = server->accept();
+      if (!client)
+        break;
+      server->clientCallback(client);
+    }
+  }
+}
+
+uint8_t WiFiServer::broadcast(WiFiClient clients[], uint8_t count, const uint8_t* data, size_t length,
+    const WiFiClient* except, bool results[]) {
+  uint8_t sent = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    WiFiClient& client = clients[i];
+    bool ok = false;
+    if (client && !(except && client == *except)) {
+      ok = (client.stream->writeUnbuffered(data, length) == length);
+      if (ok) {
+        sent++;
+      }
+    }
+    if (results) {
+      results[i] = ok;
+    }
+  }
+  return sent;
+}
+
+void WiFiServer::setClientBufferSizes(size_t rxBufferSize, size_t txBufferSize) {
+  clientRxBufferSize = rxBufferSize;
+  clientTxBufferSize = txBufferSize;
+}
+
 WiFiServer::operator bool() {
   return (state != CLOSED);
 }
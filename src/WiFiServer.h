@@ -21,6 +21,7 @@
 #define _WIFISERVER_H_
 
 #include "WiFiClient.h"
+#include "WiFiClientT.h"
 
 #ifndef WIFIESPAT_SERVER_MAX_CLIENTS
 #define WIFIESPAT_SERVER_MAX_CLIENTS 1
@@ -30,10 +31,15 @@
 #define WIFIESPAT_SERVER_CLIENT_TIMEOUT 60  // seconds
 #endif
 
+typedef void (*ServerClientCallbackFnc)(WiFiClient& client);
+
 class WiFiServer {
 
+  friend WiFiPoll;
+
 public:
   WiFiServer(uint16_t port = 80);
+  ~WiFiServer();
   void begin() { begin(WIFIESPAT_SERVER_MAX_CLIENTS, WIFIESPAT_SERVER_CLIENT_TIMEOUT); }
   void begin(uint8_t maxConnCount, uint16_t serverTimeout);
   void begin(uint16_t port) { begin(port, WIFIESPAT_SERVER_MAX_CLIENTS, WIFIESPAT_SERVER_CLIENT_TIMEOUT); }
@@ -46,11 +52,54 @@ public:
   uint8_t status();
   WiFiClient available() __attribute__((deprecated("Use accept().")));
   WiFiClient accept();
+  template<size_t RX_BUFFER_SIZE, size_t TX_BUFFER_SIZE>
+  bool accept(WiFiClientT<RX_BUFFER_SIZE, TX_BUFFER_SIZE>& client); // accepts into a client with inline buffers
   virtual operator bool();
 
+  // buffer sizes for accepted clients. default are the sizes from WiFiEspAtConfig.h
+  void setClientBufferSizes(size_t rxBufferSize, size_t txBufferSize);
+
+  // the callback gets the accepted clients. it is called from the library functions
+  // (e.g. client.available()) when a new connection is detected. nullptr to remove
+  void onClient(ServerClientCallbackFnc callback);
+
+  // sends the data to all clients in the array except one (nullptr for none).
+  // the data are sent from the provided buffer, not copied into the clients' TX buffers.
+  // a failed client doesn't stop the sending. results[i] is true if clients[i] got the data.
+  // returns the count of clients which got the data
+  static uint8_t broadcast(WiFiClient clients[], uint8_t count, const uint8_t* data, size_t length,
+      const WiFiClient* except = nullptr, bool results[] = nullptr);
+  static uint8_t broadcast(WiFiClient clients[], uint8_t count, const char* s,
+      const WiFiClient* except = nullptr, bool results[] = nullptr) {
+    return broadcast(clients, count, (const uint8_t*) s, strlen(s), except, results);
+  }
+
+  // AT 2 TCP options applied to accepted clients. the object must exist while the server runs
+  void setClientTcpOptions(const WiFiTcpOptions* options) {clientTcpOptions = options;}
+
 private:
   uint16_t port;
   uint8_t state;
+  size_t clientRxBufferSize = WIFIESPAT_CLIENT_RX_BUFFER_SIZE;
+  size_t clientTxBufferSize = WIFIESPAT_CLIENT_TX_BUFFER_SIZE;
+  const WiFiTcpOptions* clientTcpOptions = nullptr;
+  ServerClientCallbackFnc clientCallback = nullptr;
+  WiFiServer* nextCallbackServer = nullptr;
+
+  static WiFiServer* callbackServers;
+  static void dispatchClients();
+
+  uint8_t acceptLinkId();
 };
 
+template<size_t RX_BUFFER_SIZE, size_t TX_BUFFER_SIZE>
+bool WiFiServer::accept(WiFiClientT<RX_BUFFER_SIZE, TX_BUFFER_SIZE>& client) {
+  uint8_t linkId = acceptLinkId();
+  if (linkId == NO_LINK)
+    return false;
+  client.stop();
+  client.attach(linkId);
+  return true;
+}
+
 #endif
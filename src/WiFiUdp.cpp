@@ -21,6 +21,13 @@
 #include "WiFiUdp.h"
 #include "WiFiEspAtBuffManager.h"
 
+const uint8_t PACER_RECORD_HEADER = 5; // length, port, host length
+
+WiFiUDP::~WiFiUDP() {
+  stop();
+  setSendRate(0, 0);
+}
+
 int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
   EspAtDrv.ip2str(ip, strIP);
   return beginPacket(strIP, port);
@@ -30,6 +37,7 @@ int WiFiUDP::beginPacket(const char *host, uint16_t port) {
   if (txStream) {
     endPacket();
   }
+  sendQueued();
   uint8_t linkId;
   if (listening) {
     linkId = this->linkId; // AT allows to use the listener's linkId for sending
@@ -38,7 +46,7 @@ int WiFiUDP::beginPacket(const char *host, uint16_t port) {
   }
   if (linkId == NO_LINK)
     return false;
-  txStream = WiFiEspAtBuffManager.getBuffStream(linkId, 0, WIFIESPAT_UDP_TX_BUFFER_SIZE);
+  txStream = WiFiEspAtBuffManager.getBuffStream(linkId, 0, txBufferSize);
   if (!txStream) {
    if (!listening) {
     EspAtDrv.close(linkId);
@@ -52,14 +60,139 @@ int WiFiUDP::beginPacket(const char *host, uint16_t port) {
 int WiFiUDP::endPacket() {
   if (!txStream)
     return 0;
+  bool ok = true;
+  if (pacer && txStream->txBufferLength) {
+    sendQueued();
+    if (pacer->queueLength || !pacerTake(txStream->txBufferLength)) { // queue to keep the order
+      ok = pacerEnqueue(txStream->udpHost, txStream->udpPort, txStream->txBuffer, txStream->txBufferLength);
+      txStream->txBufferLength = 0;
+      if (!ok) {
+        pacer->dropped++;
+      }
+    }
+  }
   flush();
+  if (ok && txStream->getWriteError()) {
+    ok = false;
+    if (pacer) {
+      pacer->dropped++;
+    }
+  }
   if (listening) {
     txStream->free();
   } else {
     txStream->close();
   }
   txStream = nullptr;
-  return !getWriteError();
+  return ok;
+}
+
+bool WiFiUDP::setSendRate(uint16_t packetsPerSecond, uint32_t bytesPerSecond, size_t queueSize) {
+  if (pacer) {
+    delete[] pacer->queue;
+    delete pacer;
+    pacer = nullptr;
+  }
+  if (!packetsPerSecond && !bytesPerSecond)
+    return true;
+  pacer = new Pacer();
+  if (!pacer)
+    return false;
+  pacer->queue = queueSize ? new uint8_t[queueSize] : nullptr;
+  if (queueSize && !pacer->queue) {
+    delete pacer;
+    pacer = nullptr;
+    return false;
+  }
+  pacer->queueSize = queueSize;
+  pacer->packetRate = packetsPerSecond;
+  pacer->byteRate = bytesPerSecond;
+  pacer->lastMillis = millis() - 100; // pacerTake fills the buckets
+  return true;
+}
+
+size_t WiFiUDP::sendQueued() {
+  if (!pacer)
+    return 0;
+  while (pacer->queueLength) {
+    uint8_t* record = pacer->queue;
+    size_t length = record[0] | (record[1] << 8);
+    if (!pacerTake(length))
+      break;
+    uint16_t port = record[2] | (record[3] << 8);
+    const char* host = (const char*) record + PACER_RECORD_HEADER;
+    size_t recordLength = PACER_RECORD_HEADER + record[4] + length;
+    if (!pacerSend(host, port, record + PACER_RECORD_HEADER + record[4], length)) {
+      pacer->dropped++;
+    }
+    pacer->queueLength -= recordLength;
+    memmove(pacer->queue, pacer->queue + recordLength, pacer->queueLength);
+  }
+  return pacer->queueLength;
+}
+
+unsigned long WiFiUDP::droppedPackets() {
+  if (!pacer)
+    return 0;
+  return pacer->dropped;
+}
+
+/**
+ * Refills the buckets for the time elapsed and takes the tokens for a packet.
+ * A bucket holds 100 milliseconds of its rate. A packet is sent if the bucket
+ * isn't empty, so a packet larger than the bucket is sent too and the debt
+ * delays the next packets.
+ */
+bool WiFiUDP::pacerTake(size_t length) {
+  unsigned long elapsed = millis() - pacer->lastMillis;
+  pacer->lastMillis += elapsed;
+  if (pacer->packetRate) {
+    int32_t capacity = (pacer->packetRate < 10) ? 1000 : (int32_t) pacer->packetRate * 100;
+    int64_t tokens = pacer->packetTokens + (int64_t) elapsed * pacer->packetRate; // 64 bit for a long idle time
+    pacer->packetTokens = (tokens > capacity) ? capacity : (int32_t) tokens;
+  }
+  if (pacer->byteRate) {
+    int32_t capacity = (pacer->byteRate < 10) ? 1000 : (int32_t) pacer->byteRate * 100;
+    int64_t tokens = pacer->byteTokens + (int64_t) elapsed * pacer->byteRate;
+    pacer->byteTokens = (tokens > capacity) ? capacity : (int32_t) tokens;
+  }
+  if ((pacer->packetRate && pacer->packetTokens <= 0) || (pacer->byteRate && pacer->byteTokens <= 0))
+    return false;
+  if (pacer->packetRate) {
+    pacer->packetTokens -= 1000;
+  }
+  if (pacer->byteRate) {
+    pacer->byteTokens -= (int32_t) length * 1000;
+  }
+  return true;
+}
+
+bool WiFiUDP::pacerEnqueue(const char* host, uint16_t port, const uint8_t* data, size_t length) {
+  size_t hostLength = strlen(host) + 1;
+  size_t recordLength = PACER_RECORD_HEADER + hostLength + length;
+  if (hostLength > 255 || length > 0xFFFF || pacer->queueLength + recordLength > pacer->queueSize)
+    return false;
+  uint8_t* record = pacer->queue + pacer->queueLength;
+  record[0] = length & 0xFF;
+  record[1] = length >> 8;
+  record[2] = port & 0xFF;
+  record[3] = port >> 8;
+  record[4] = hostLength;
+  memcpy(record + PACER_RECORD_HEADER, host, hostLength);
+  memcpy(record + PACER_RECORD_HEADER + hostLength, data, length);
+  pacer->queueLength += recordLength;
+  return true;
+}
+
+bool WiFiUDP::pacerSend(const char* host, uint16_t port, const uint8_t* data, size_t length) {
+  if (listening)
+    return EspAtDrv.sendData(linkId, data, length, host, port) == length;
+  uint8_t id = EspAtDrv.connect("UDP", host, port);
+  if (id == NO_LINK)
+    return false;
+  bool ok = (EspAtDrv.sendData(id, data, length, host, port) == length);
+  EspAtDrv.close(id);
+  return ok;
 }
 
 size_t WiFiUDP::write(uint8_t b) {
@@ -71,6 +204,16 @@ size_t WiFiUDP::write(uint8_t b) {
 size_t WiFiUDP::write(const uint8_t *data, size_t length) {
   if (!txStream)
     return 0;
+  if (pacer && txStream->txBufferLength == 0 && length > txStream->txBufferSize) {
+    // the stream sends a large buffer right away, so it is paced here instead of in endPacket
+    sendQueued();
+    if (pacer->queueLength || !pacerTake(length)) {
+      if (pacerEnqueue(txStream->udpHost, txStream->udpPort, data, length))
+        return length;
+      txStream->setWriteError(); // endPacket counts it as dropped
+      return 0;
+    }
+  }
   return txStream->write(data, length);
 }
 
@@ -86,6 +229,11 @@ int WiFiUDP::availableForWrite() {
   return txStream->availableForWrite();
 }
 
+void WiFiUDP::setBufferSizes(size_t _rxBufferSize, size_t _txBufferSize) {
+  rxBufferSize = _rxBufferSize;
+  txBufferSize = _txBufferSize;
+}
+
 size_t WiFiUDP::write(SendCallbackFnc callback) {
   if (!txStream)
     return 0;
@@ -103,6 +251,8 @@ uint8_t WiFiUDP::begin(uint16_t port) {
 }
 
 IPAddress WiFiUDP::remoteIP() {
+  if (senderPort)
+    return senderIP;
   IPAddress ip;
   uint16_t port = 0;
   uint16_t lport = 0;
@@ -113,6 +263,8 @@ IPAddress WiFiUDP::remoteIP() {
 }
 
 uint16_t WiFiUDP::remotePort() {
+  if (senderPort)
+    return senderPort;
   IPAddress ip;
   uint16_t port = 0;
   uint16_t lport = 0;
@@ -189,12 +341,18 @@ int WiFiUDP::parsePacket() {
     rxStream->free();
     rxStream = nullptr;
   }
-  if (!availableForParse())
+  size_t len = availableForParse();
+  if (!len)
     return 0;
-  rxStream = WiFiEspAtBuffManager.getBuffStream(NO_LINK, WIFIESPAT_UDP_RX_BUFFER_SIZE, 0);
+  if (len < rxBufferSize) {
+    len = rxBufferSize;
+  } else if (len > WIFIESPAT_UDP_RX_MAX_SIZE) {
+    len = (rxBufferSize > WIFIESPAT_UDP_RX_MAX_SIZE) ? rxBufferSize : WIFIESPAT_UDP_RX_MAX_SIZE;
+  }
+  rxStream = WiFiEspAtBuffManager.getBuffStream(NO_LINK, len, 0);
   if (!rxStream)
     return 0;
-  rxStream->rxBufferLength = WiFiUDP::parsePacket(rxStream->rxBuffer, WIFIESPAT_UDP_RX_BUFFER_SIZE, senderIP, senderPort);
+  rxStream->rxBufferLength = WiFiUDP::parsePacket(rxStream->rxBuffer, rxStream->rxBufferSize, senderIP, senderPort);
 #endif
   return available();
 }
@@ -224,12 +382,12 @@ int WiFiUDP::peek() {
 }
 
 #ifdef WIFIESPAT1
-uint8_t WiFiUDP::readRxData(Stream* serial, size_t len) {
+uint8_t WiFiUDP::readRxData(Stream* serial, size_t len, const IPAddress& ip, uint16_t port) {
   if (available() > 0) // to avoid overwrite of previous packet
     return BUSY;
-  if (len > WIFIESPAT_UDP_RX_BUFFER_SIZE)
+  if (len > WiFiEspAtBuffManagerClass::sizeClass(rxBufferSize))
     return LARGE;
-  rxStream = WiFiEspAtBuffManager.getBuffStream(NO_LINK, WIFIESPAT_UDP_RX_BUFFER_SIZE, 0);
+  rxStream = WiFiEspAtBuffManager.getBuffStream(NO_LINK, rxBufferSize, 0);
   if (!rxStream)
     return BUSY;
   size_t l = serial->readBytes(rxStream->rxBuffer, len);
@@ -239,6 +397,8 @@ uint8_t WiFiUDP::readRxData(Stream* serial, size_t len) {
     return TIMEOUT;
   }
   rxStream->rxBufferLength = len;
+  senderIP = ip;
+  senderPort = port;
   return OK;
 }
 #endif
@@ -25,12 +25,21 @@
 #include "WiFiEspAtSharedBuffStreamPtr.h"
 #include "utility/EspAtDrvTypes.h"
 
+class WiFiPoll;
+
 class WiFiUDP : public UDP
 #ifdef WIFIESPAT1
 , protected EspAtDrvUdpDataCallback
 #endif
 {
+  friend WiFiPoll;
+
 public:
+  WiFiUDP() {}
+  ~WiFiUDP();
+
+  WiFiUDP(const WiFiUDP&) = delete;
+  WiFiUDP& operator=(const WiFiUDP&) = delete;
 
   // Sending UDP packets
   virtual int beginPacket(IPAddress ip, uint16_t port);
@@ -46,12 +55,25 @@ public:
 
   using Print::write;
 
+  // paces the packets sent with endPacket(). a rate 0 is not limited. a packet over the rate
+  // is queued in a buffer of queueSize bytes and sent by sendQueued() or the next beginPacket/endPacket.
+  // a packet which doesn't fit into the queue is dropped. setSendRate(0, 0) stops the pacing.
+  // a packet written with write(callback) is sent right away and is not paced
+  bool setSendRate(uint16_t packetsPerSecond, uint32_t bytesPerSecond = 0, size_t queueSize = WIFIESPAT_UDP_PACER_QUEUE_SIZE);
+  size_t sendQueued(); // returns the count of bytes left in the queue
+  unsigned long droppedPackets(); // not queued or failed to send (SEND FAIL)
+
   virtual uint8_t begin(uint16_t port);
 
+  // default are the sizes from WiFiEspAtConfig.h. the RX size limits the received message size.
+  // with AT2 a larger message gets a larger buffer up to WIFIESPAT_UDP_RX_MAX_SIZE
+  void setBufferSizes(size_t rxBufferSize, size_t txBufferSize);
+
 #ifndef WIFIESPAT1 // AT2
   virtual uint8_t beginMulticast(IPAddress ip, uint16_t port);
 
-  // WiFiEspAT AT2 special functions for receive
+  // WiFiEspAT AT2 special functions for receive. availableForParse returns the size
+  // of the whole next message. parsePacket reads it directly into the provided buffer
   size_t availableForParse();
   size_t parsePacket(uint8_t* buffer, size_t bufferSize, IPAddress& remoteIP, uint16_t& remotePort);
 #endif
@@ -67,11 +89,13 @@ public:
   virtual int peek();
 
 #ifdef WIFIESPAT1
+  // the sender of the parsed message. without AT+CIPDINFO support the AT firmware is asked
   virtual IPAddress remoteIP();
   virtual uint16_t remotePort();
 
 protected:
-  virtual uint8_t readRxData(Stream* serial, size_t len); // EspAtDrvUdpDataCallback implementation
+  // EspAtDrvUdpDataCallback implementation
+  virtual uint8_t readRxData(Stream* serial, size_t len, const IPAddress& ip, uint16_t port);
 
 #else
   virtual IPAddress remoteIP() {return senderIP;}
@@ -85,11 +109,31 @@ private:
   WiFiEspAtSharedBuffStreamPtr txStream;
   WiFiEspAtSharedBuffStreamPtr rxStream;
   char strIP[16]; // to hold the string version of IP for beginPacket(ip, port);
+  size_t rxBufferSize = WIFIESPAT_UDP_RX_BUFFER_SIZE;
+  size_t txBufferSize = WIFIESPAT_UDP_TX_BUFFER_SIZE;
+
+  // token bucket. the tokens are in 1/1000 of a packet or byte
+  struct Pacer {
+    uint16_t packetRate;
+    uint32_t byteRate;
+    int32_t packetTokens;
+    int32_t byteTokens;
+    unsigned long lastMillis;
+    uint8_t* queue;
+    size_t queueSize;
+    size_t queueLength;
+    unsigned long dropped;
+  };
+  Pacer* pacer = nullptr;
+
+  bool pacerTake(size_t length);
+  bool pacerEnqueue(const char* host, uint16_t port, const uint8_t* data, size_t length);
+  bool pacerSend(const char* host, uint16_t port, const uint8_t* data, size_t length);
 
-#ifndef WIFIESPAT1 //AT2
   IPAddress senderIP;
-  uint16_t senderPort;
+  uint16_t senderPort = 0;
 
+#ifndef WIFIESPAT1 //AT2
   uint8_t begin(const char* ip, uint16_t port);
 #endif
 };
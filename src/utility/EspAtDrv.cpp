@@ -47,7 +47,12 @@ const char IGNORED[] PROGMEM = " ...ignored";
 
 static bool (*unsolicitedMessage)(char *buffer) = NULL;
 
+#ifdef WIFIESPAT_THREAD_SAFE
+EspAtDrvLock espAtDrvLock;
+#endif
+
 void EspAtDrvClass::setUnsolicitedMessageCallback(bool (*callback)(char *buffer)){
+  ESPATDRV_LOCK();
     unsolicitedMessage = callback;
 }
 
@@ -71,6 +76,7 @@ public:
 #endif
 
 bool EspAtDrvClass::init(Stream* _serial, int8_t resetPin) {
+  ESPATDRV_LOCK();
   serial = _serial;
 #if WIFIESPAT_LOG_LEVEL < LOG_LEVEL_DEBUG
   cmd = _serial;
@@ -83,6 +89,7 @@ bool EspAtDrvClass::init(Stream* _serial, int8_t resetPin) {
 }
 
 bool EspAtDrvClass::reset(int8_t resetPin) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -101,6 +108,20 @@ bool EspAtDrvClass::reset(int8_t resetPin) {
     cmd->print(F("AT+RST"));
     sendCommand(PSTR("ready")); // can be missed
   }
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) {
+    if (linkInfo[linkId].isConnecting()) {
+      asyncConnectFree(linkId);
+    }
+  }
+  // the SSL settings of the firmware are back to default
+#ifdef WIFIESPAT1
+  sslBufferSize = 0;
+#else
+  sslConfiguredLinks = 0;
+  sslSniLinks = 0;
+  sslAlpnLinks = 0;
+#endif
+
   if (!simpleCommand(PSTR("ATE0")) || // turn off echo. must work
       !simpleCommand(PSTR("AT+CIPMUX=1")) ||  // Enable multiple connections.
       !simpleCommand(PSTR("AT+CIPRECVMODE=1"))) // Set TCP Receive Mode - passive
@@ -112,7 +133,17 @@ bool EspAtDrvClass::reset(int8_t resetPin) {
      LOG_WARN_PRINT_PREFIX();
      LOG_WARN_PRINTLN(F("Error setting store mode. Is the firmware AT2?"));
    }
+   // +LINK_CONN with the remote IP and ports instead of CONNECT. not supported by old AT 2 versions
+   simpleCommand(PSTR("AT+SYSMSG=2"));
 #endif
+  // AT 1: +IPD of UDP with the sender of the message.
+  // AT 2: +CIPRECVDATA with the sender of the data, so recvDataWithInfo needs only one command
+  recvDataInfo = simpleCommand(PSTR("AT+CIPDINFO=1"));
+  probesPending = 0; // answered or lost in the reset
+  powerSleep = false;
+  apPrintMask = 0; // AT+CWLAPOPT is not known after reset
+  netConfigGeneration++;
+  staStateChange(ESPAT_STA_UNKNOWN); // the firmware may auto-connect
 
   // read default wifi mode
   cmd->print(F("AT+CWMODE?"));
@@ -126,11 +157,64 @@ bool EspAtDrvClass::reset(int8_t resetPin) {
 }
 
 void EspAtDrvClass::maintain() {
+  maintain(true);
+}
+
+/**
+ * The send functions call it with dispatchIncoming false. The incoming callback
+ * could write to the stream which is just sending its buffer.
+ */
+void EspAtDrvClass::maintain(bool dispatchIncoming) {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+  scanWait();
+  joinWait();
+  asyncConnectWait(); // the AT firmware can't take a command before AT+CIPSTART is finished
+  linksMaintain();
+  powerMaintain();
+  maintainDispatch(false); // the command of the calling function follows
+  if (dispatchIncoming) {
+    incomingDispatch(); // the callback runs before the command which called maintain() is sent
+  }
+}
+
+/**
+ * Processes the received messages without waiting for the result of a pending
+ * AT+CWLAP, AT+CWJAP or AT+CIPSTART. For functions which don't send a command.
+ */
+void EspAtDrvClass::poll() {
   lastErrorCode = EspAtDrvError::NO_ERROR;
   readRX(nullptr, false);
+  maintainDispatch(true);
+  incomingDispatch();
+}
+
+void EspAtDrvClass::maintainDispatch(bool idle) {
+  if (maintainCallback && !maintainDispatching) {
+    maintainDispatching = true;
+    maintainCallback(idle);
+    maintainDispatching = false;
+    lastErrorCode = EspAtDrvError::NO_ERROR;
+  }
+}
+
+void EspAtDrvClass::incomingDispatch() {
+  if (incomingPending && incomingCallback && !incomingDispatching) {
+    incomingPending = false;
+    incomingDispatching = true;
+    incomingCallback();
+    incomingDispatching = false;
+    lastErrorCode = EspAtDrvError::NO_ERROR;
+  }
+}
+
+bool EspAtDrvClass::asyncCommandPending() {
+  return asyncLinkId != NO_LINK || scanStatus == ESPAT_SCAN_RUNNING || joinStatus == ESPAT_CONNECT_PENDING;
 }
 
 bool EspAtDrvClass::firmwareVersion(char* buff) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -147,10 +231,13 @@ bool EspAtDrvClass::firmwareVersion(char* buff) {
 }
 
 bool EspAtDrvClass::sysPersistent(bool _persistent) {
+  ESPATDRV_LOCK();
 #ifdef WIFIESPAT1
   persistent = _persistent;
   return true;
 #else
+  maintain();
+
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("sys store "));
   LOG_INFO_PRINTLN(_persistent ? F("on") : F("off"));
@@ -170,11 +257,18 @@ bool EspAtDrvClass::sysStoreInternal(bool store) {
   return sendCommand();
 }
 
+/**
+ * The STA state is tracked from the WIFI messages of the AT firmware,
+ * so AT+CIPSTATUS is sent only if the state is not known.
+ * The cached state is returned without waiting for a pending async command.
+ * Returns the AT+CIPSTATUS status: 2, 3 or 4 got IP, 5 not connected.
+ * AT 2 returns 0 for STA not initialized and 1 for STA not started to connect.
+ * A tracked connection without IP returns 5.
+ */
 int EspAtDrvClass::staStatus() {
-  maintain();
-  
-  LOG_INFO_PRINT_PREFIX();
-  LOG_INFO_PRINTLN(F("wifi status"));
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
 
   if (wifiModeDef == -1) { // reset() was not executed successful
     LOG_ERROR_PRINT_PREFIX();
@@ -183,49 +277,74 @@ int EspAtDrvClass::staStatus() {
     return -1;
   }
 
+  EspAtStaState state = staStateValue;
+#ifndef ESPATDRV_ASSUME_FLOW_CONTROL
+  if (millis() - staStateMillis > 10000) { // a WIFI message could be lost in RX buffer overflow
+    state = ESPAT_STA_UNKNOWN; // query it again. staStateChange invalidates only on a change
+  }
+#endif
+  int status = -1;
+  switch (state) {
+    case ESPAT_STA_GOT_IP:
+      status = 2;
+      break;
+    case ESPAT_STA_CONNECTED: // without IP
+    case ESPAT_STA_DISCONNECTED:
+      status = 5;
+      break;
+    default:
+      break;
+  }
+  if (status != -1) {
+    maintainDispatch(true); // no command is sent
+    incomingDispatch();
+    return status;
+  }
+
+  maintain();
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("wifi status"));
+
   cmd->print((FSH_P) AT_CIPSTATUS);
   if (!sendCommand(STATUS))
     return -1;
-  uint8_t status = buffer[strlen("STATUS:")] - 48;
-  return readOK() ? status : -1;
+  status = buffer[strlen("STATUS:")] - 48;
+  if (!readOK())
+    return -1;
+  switch (status) {
+    case 2:
+    case 3:
+    case 4:
+      staStateChange(ESPAT_STA_GOT_IP);
+      break;
+    default: // AT 2 0 not initialized, 1 not started to connect
+      staStateChange(ESPAT_STA_DISCONNECTED);
+  }
+  return status;
 }
 
 int EspAtDrvClass::ethStatus() {
+  ESPATDRV_LOCK();
   maintain();
 
   return ethConnected;
 }
 
-uint8_t EspAtDrvClass::listAP(WiFiApData apData[], uint8_t size) {
+uint8_t EspAtDrvClass::listAP(WiFiApData apData[], uint8_t size, const WiFiScanFilter* filter) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("list AP"));
 
-  uint8_t mode = wifiMode | WIFI_MODE_STA; // turn on STA, leave SoftAP as it is
-  if (!setWifiMode(mode, false))
+  if (!scanStart(filter))
     return 0;
-  if (!simpleCommand(PSTR("AT+CWLAPOPT=1,31"))) // sort and first 5 values (0b0000011111)
-    return false;
-  cmd->print(F("AT+CWLAP"));
   uint8_t count = 0;
   bool found = sendCommand(PSTR("+CWLAP"), true, true);
   while (found) {
-    WiFiApData& r = apData[count];
-    const char* delims = ",:\")";
-    char* tok = strtok(buffer + strlen("+CWLAP:("), delims); // <enc>
-    r.enc = atoi(tok);
-    tok = strtok(NULL, delims); // <ssid>
-    strcpy(r.ssid, tok);
-    tok = strtok(NULL, delims); // <rssi>
-    r.rssi = atoi(tok);
-    for (int i = 0; i < 6; i++) {
-      tok = strtok(NULL, delims); // <bssid>[i]
-      r.bssid[i] = strtoul(tok, NULL, 16);
+    if (parseAP(apData[count])) {
+      count++;
     }
-    tok = strtok(NULL, delims); // <channel>
-    r.channel = atoi(tok);
-    count++;
     if (count == size)
       break;
     found = readRX(PSTR("+CWLAP"), true, true);
@@ -236,8 +355,182 @@ uint8_t EspAtDrvClass::listAP(WiFiApData apData[], uint8_t size) {
   return count;
 }
 
+/**
+ * The +CWLAP messages are processed by readRX while the scan runs.
+ * OK or ERROR of AT+CWLAP ends the scan. Other commands wait in maintain()
+ * for the end of the scan.
+ */
+bool EspAtDrvClass::scanAsync(EspAtScanCallback callback, const WiFiScanFilter* filter) {
+  ESPATDRV_LOCK();
+  maintain();
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("scan AP"));
+
+  if (!scanStart(filter))
+    return false;
+  scanCallback = callback;
+  LOG_DEBUG_PRINT(F(" ...sent"));
+  cmd->println(); // +CWLAP lines, OK or ERROR will be read by readRX
+  scanStatus = ESPAT_SCAN_RUNNING;
+  return true;
+}
+
+EspAtScanStatus EspAtDrvClass::scanAsyncStatus() {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+  return scanStatus;
+}
+
+/**
+ * Sets the wifi mode and AT+CWLAPOPT and prints AT+CWLAP with the parameters
+ * of the filter. The caller sends the command.
+ * AT+CWLAPOPT is sent only if it differs from the last one.
+ */
+bool EspAtDrvClass::scanStart(const WiFiScanFilter* filter) {
+  if (filter && filter->bssid && !filter->ssid) { // AT+CWLAP has the mac after the ssid
+    LOG_ERROR_PRINT_PREFIX();
+    LOG_ERROR_PRINTLN(F("scan filter bssid requires ssid"));
+    return false;
+  }
+  scanFilter = filter ? *filter : WiFiScanFilter();
+  uint8_t mask = scanFilter.fields & WIFI_AP_ALL;
+  if (scanFilter.minRssi > -128) {
+    mask |= WIFI_AP_RSSI; // for filtering in the library
+  }
+  if (!mask) {
+    mask = WIFI_AP_ALL;
+  }
+  scanFilter.fields = mask;
+
+  uint8_t mode = wifiMode | WIFI_MODE_STA; // turn on STA, leave SoftAP as it is
+  if (!setWifiMode(mode, false))
+    return false;
+#ifdef WIFIESPAT1
+  int8_t rssiFilter = -100; // not supported
+#else
+  int8_t rssiFilter = (scanFilter.minRssi > -100) ? scanFilter.minRssi : -100; // AT 2 range is -100 to 40
+#endif
+  if (mask != apPrintMask || rssiFilter != apRssiFilter) {
+    apPrintMask = 0;
+    cmd->print(F("AT+CWLAPOPT=1,")); // sorted by RSSI
+    cmd->print(mask);
+    if (rssiFilter > -100 || apRssiFilter > -100) {
+      cmd->print(',');
+      cmd->print(rssiFilter);
+      if (!sendCommand()) { // older AT 2 versions don't have the RSSI filter. the library filters
+        rssiFilter = -100;
+        cmd->print(F("AT+CWLAPOPT=1,"));
+        cmd->print(mask);
+        if (!sendCommand())
+          return false;
+      }
+    } else if (!sendCommand())
+      return false;
+    apPrintMask = mask;
+    apRssiFilter = rssiFilter;
+  }
+  cmd->print(F("AT+CWLAP"));
+  if (scanFilter.ssid || scanFilter.channel) { // AT+CWLAP=[<ssid>,<mac>,<channel>]
+    cmd->print('=');
+    if (scanFilter.ssid) {
+      cmd->print('"');
+      cmd->print(scanFilter.ssid);
+      cmd->print('"');
+    }
+    if (scanFilter.ssid && scanFilter.bssid) {
+      cmd->print(F(",\""));
+      printMAC(cmd, scanFilter.bssid);
+      cmd->print('"');
+    } else if (scanFilter.channel) {
+      cmd->print(',');
+    }
+    if (scanFilter.channel) {
+      cmd->print(',');
+      cmd->print(scanFilter.channel);
+    }
+  }
+  return true;
+}
+
+/**
+ * Parses the +CWLAP line in buffer. Only the fields of the print mask are in the line.
+ * The quoted SSID can be empty (hidden AP) and can contain the delimiters.
+ * Returns false if a field is missing or the AP doesn't pass the filter of the scan.
+ */
+bool EspAtDrvClass::parseAP(WiFiApData& r) {
+  uint8_t mask = scanFilter.fields;
+  memset(&r, 0, sizeof(WiFiApData));
+  char* p = buffer + strlen("+CWLAP:(");
+  for (uint8_t field = WIFI_AP_ENC; field <= WIFI_AP_CHANNEL; field <<= 1) {
+    if (!(mask & field))
+      continue;
+    if (!*p)
+      return false;
+    char* tok = p;
+    if (*tok == '"') { // the end is a quote followed by a delimiter
+      tok++;
+      p = tok;
+      while (*p && !(*p == '"' && (p[1] == ',' || p[1] == ')' || !p[1]))) {
+        p++;
+      }
+      if (!*p)
+        return false;
+      *p++ = 0;
+    } else {
+      while (*p && *p != ',' && *p != ')') {
+        p++;
+      }
+    }
+    if (*p) {
+      *p++ = 0;
+    }
+    switch (field) {
+      case WIFI_AP_ENC:
+        r.enc = atoi(tok);
+        break;
+      case WIFI_AP_SSID:
+        strncpy(r.ssid, tok, sizeof(r.ssid) - 1);
+        break;
+      case WIFI_AP_RSSI:
+        r.rssi = atoi(tok);
+        break;
+      case WIFI_AP_BSSID:
+        for (int i = 0; i < 6; i++) {
+          r.bssid[i] = strtoul(tok, &tok, 16);
+          if (*tok == ':') {
+            tok++;
+          }
+        }
+        break;
+      case WIFI_AP_CHANNEL:
+        r.channel = atoi(tok);
+        break;
+    }
+  }
+  // AT 1 has no RSSI filter. ssid and channel are checked for the case the firmware ignores the parameters
+  if ((mask & WIFI_AP_RSSI) && r.rssi < scanFilter.minRssi)
+    return false;
+  if ((mask & WIFI_AP_SSID) && scanFilter.ssid && strcmp(scanFilter.ssid, r.ssid))
+    return false;
+  if ((mask & WIFI_AP_CHANNEL) && scanFilter.channel && scanFilter.channel != r.channel)
+    return false;
+  return true;
+}
+
+void EspAtDrvClass::scanWait() {
+  while (scanStatus == ESPAT_SCAN_RUNNING) {
+    if (!readRX(OK)) { // OK or ERROR of AT+CWLAP is handled in readRX
+      scanStatus = ESPAT_SCAN_FAILED;
+    }
+  }
+}
+
 bool EspAtDrvClass::staStaticIp(const IPAddress& ip, const IPAddress& gw, const IPAddress& nm) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set static IP "));
@@ -266,10 +559,14 @@ bool EspAtDrvClass::staStaticIp(const IPAddress& ip, const IPAddress& gw, const
     }
   }
   cmd->print('"');
+  staIpCached = false;
   return sendCommand();
 }
 
 bool EspAtDrvClass::staEnableDHCP() {
+  ESPATDRV_LOCK();
+  maintain();
+  netConfigGeneration++;
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("enable DHCP "));
   LOG_INFO_PRINTLN(persistent ? F("persistent") : F("current") );
@@ -277,6 +574,7 @@ bool EspAtDrvClass::staEnableDHCP() {
   uint8_t mode = wifiMode | WIFI_MODE_STA; // turn on STA, leave SoftAP as it is
   if (!setWifiMode(mode, false))
     return false; // can't enable dhcp without sta mode
+  staIpCached = false;
 
 #ifdef WIFIESPAT1
   // AT 1 AT+CWDHCP= parameters are strange. first parameter is 0 AP, 1 STA, 2 both. second is 0/1
@@ -294,7 +592,9 @@ bool EspAtDrvClass::staEnableDHCP() {
 }
 
 bool EspAtDrvClass::setDNS(const IPAddress& dns1, const IPAddress& dns2) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
   
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set static DNS "));
@@ -324,6 +624,7 @@ bool EspAtDrvClass::setDNS(const IPAddress& dns1, const IPAddress& dns2) {
 }
 
 bool EspAtDrvClass::staMacQuery(uint8_t* mac) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -342,8 +643,16 @@ bool EspAtDrvClass::staMacQuery(uint8_t* mac) {
 }
 
 bool EspAtDrvClass::staIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mask) {
+  ESPATDRV_LOCK();
   maintain();
 
+  if (staIpCached && staStateValue != ESPAT_STA_UNKNOWN) { // the WIFI messages clear the cache
+    ip = staIp;
+    gwip = staGw;
+    mask = staMask;
+    return true;
+  }
+
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("STA IP query"));
 
@@ -360,10 +669,17 @@ bool EspAtDrvClass::staIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mask)
     return false;
   buffer[strlen(buffer) - 1] = 0;
   mask.fromString(buffer + strlen("+CIPSTA:netmask:\""));
-  return readOK();
+  if (!readOK())
+    return false;
+  staIp = ip;
+  staGw = gwip;
+  staMask = mask;
+  staIpCached = true;
+  return true;
 }
 
 bool EspAtDrvClass::dnsQuery(IPAddress& dns1, IPAddress& dns2) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -396,6 +712,7 @@ bool EspAtDrvClass::dnsQuery(IPAddress& dns1, IPAddress& dns2) {
 }
 
 bool EspAtDrvClass::joinAP(const char* ssid, const char* password, const uint8_t* bssid) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -403,6 +720,79 @@ bool EspAtDrvClass::joinAP(const char* ssid, const char* password, const uint8_t
   LOG_INFO_PRINT(ssid);
   LOG_INFO_PRINTLN(persistent ? F(" persistent") : F(" current") );
 
+  if (!joinStart(ssid, password, bssid))
+    return false;
+  if (!sendCommand())
+    return false;
+  staStateChange(ESPAT_STA_GOT_IP);
+  if (persistent) {
+    simpleCommand(PSTR("AT+CWAUTOCONN=1"));
+  }
+  return true;
+}
+
+/**
+ * The OK or ERROR of AT+CWJAP is processed by readRX.
+ * Other commands wait in maintain() for the end of the join.
+ */
+bool EspAtDrvClass::joinAPAsync(const char* ssid, const char* password, const uint8_t* bssid) {
+  ESPATDRV_LOCK();
+  maintain();
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("join AP async "));
+  LOG_INFO_PRINTLN(ssid);
+
+  if (!joinStart(ssid, password, bssid))
+    return false;
+  LOG_DEBUG_PRINT(F(" ...sent"));
+  cmd->println();
+  joinStatus = ESPAT_CONNECT_PENDING;
+  return true;
+}
+
+EspAtConnectStatus EspAtDrvClass::joinAPAsyncStatus() {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+  return joinStatus;
+}
+
+/**
+ * Waits for the end of the join started with joinAPAsync
+ * and disconnects the STA if the join succeeded.
+ */
+bool EspAtDrvClass::joinAPAsyncCancel() {
+  ESPATDRV_LOCK();
+  maintain(); // waits for the result of AT+CWJAP
+  if (joinStatus != ESPAT_CONNECT_SUCCESS)
+    return true;
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("join AP async cancel"));
+
+  joinStatus = ESPAT_CONNECT_FAILED;
+  return simpleCommand(PSTR("AT+CWQAP"));
+}
+
+void EspAtDrvClass::staStateChange(EspAtStaState state) {
+  if (state != staStateValue) {
+    staIpCached = false;
+    netConfigGeneration++;
+  }
+  staStateValue = state;
+  staStateMillis = millis();
+}
+
+EspAtStaState EspAtDrvClass::staState() {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+  return staStateValue;
+}
+
+// prints AT+CWJAP. the caller sends the command
+bool EspAtDrvClass::joinStart(const char* ssid, const char* password, const uint8_t* bssid) {
   if (!setWifiMode(wifiMode | WIFI_MODE_STA, persistent))
     return false; // can't join ap without sta mode
 #ifdef WIFIESPAT1
@@ -422,28 +812,24 @@ bool EspAtDrvClass::joinAP(const char* ssid, const char* password, const uint8_t
     cmd->print(password);
     if (bssid) {
       cmd->print((FSH_P) QOUT_COMMA_QOUT);
-      for (int i = 0; i < 6; i++) {
-        if (bssid[i] < 16) {
-          cmd->print('0');
-        }
-        cmd->print(bssid[i], HEX);
-        if (i > 0) {
-          cmd->print(':');
-        }
-      }
+      printMAC(cmd, bssid);
     }
   }
   cmd->print('"');
  }
-  if (!sendCommand())
-    return false;
-  if (persistent) {
-    simpleCommand(PSTR("AT+CWAUTOCONN=1"));
-  }
   return true;
 }
 
+void EspAtDrvClass::joinWait() {
+  while (joinStatus == ESPAT_CONNECT_PENDING) {
+    if (!readRX(OK)) { // OK or ERROR of AT+CWJAP is handled in readRX
+      joinStatus = ESPAT_CONNECT_FAILED;
+    }
+  }
+}
+
 bool EspAtDrvClass::joinEAP(const char* ssid, uint8_t method, const char* identity, const char* username, const char* password, uint8_t security) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -479,6 +865,7 @@ bool EspAtDrvClass::joinEAP(const char* ssid, uint8_t method, const char* identi
   cmd->print(security);
   if (!sendCommand())
     return false;
+  staStateChange(ESPAT_STA_GOT_IP);
   if (persistent) {
     simpleCommand(PSTR("AT+CWAUTOCONN=1"));
   }
@@ -486,6 +873,8 @@ bool EspAtDrvClass::joinEAP(const char* ssid, uint8_t method, const char* identi
 }
 
 bool EspAtDrvClass::quitAP(bool save) {
+  ESPATDRV_LOCK();
+  maintain();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("quit AP "));
   LOG_INFO_PRINTLN((persistent || save) ? F(" persistent") : F(" current") );
@@ -507,10 +896,15 @@ bool EspAtDrvClass::quitAP(bool save) {
     persistent = save;
   }
 #endif
-  return simpleCommand(PSTR("AT+CWQAP")); // it doesn't clear the persistent settings
+  if (!simpleCommand(PSTR("AT+CWQAP"))) // it doesn't clear the persistent settings
+    return false;
+  staStateChange(ESPAT_STA_DISCONNECTED);
+  return true;
 }
 
 bool EspAtDrvClass::staAutoConnect(bool autoConnect) {
+  ESPATDRV_LOCK();
+  maintain();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("STA auto connect "));
   LOG_INFO_PRINTLN(autoConnect ? F("on") : F("off"));
@@ -521,6 +915,7 @@ bool EspAtDrvClass::staAutoConnect(bool autoConnect) {
 }
 
 bool EspAtDrvClass::apQuery(char* ssid, uint8_t* bssid, uint8_t& channel, int8_t& rssi) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -557,7 +952,9 @@ bool EspAtDrvClass::apQuery(char* ssid, uint8_t* bssid, uint8_t& channel, int8_t
 }
 
 bool EspAtDrvClass::softApIp(const IPAddress& ip, const IPAddress& gw, const IPAddress& nm) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set SoftAP IP "));
@@ -593,6 +990,7 @@ bool EspAtDrvClass::softApIp(const IPAddress& ip, const IPAddress& gw, const IPA
 }
 
 bool EspAtDrvClass::softApMacQuery(uint8_t* mac) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -611,6 +1009,7 @@ bool EspAtDrvClass::softApMacQuery(uint8_t* mac) {
 }
 
 bool EspAtDrvClass::softApIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mask) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -634,7 +1033,9 @@ bool EspAtDrvClass::softApIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mas
 
 bool EspAtDrvClass::beginSoftAP(const char *ssid, const char* passphrase, uint8_t channel,
     uint8_t encoding, uint8_t maxConnetions, bool hidden) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("begin SoftAP "));
@@ -673,7 +1074,9 @@ bool EspAtDrvClass::beginSoftAP(const char *ssid, const char* passphrase, uint8_
 }
 
 bool EspAtDrvClass::endSoftAP(bool save) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("end SoftAP "));
@@ -683,6 +1086,7 @@ bool EspAtDrvClass::endSoftAP(bool save) {
 }
 
 bool EspAtDrvClass::softApQuery(char* ssid, char* passphrase, uint8_t& channel, uint8_t& encoding, uint8_t& maxConnections, bool& hidden) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -720,7 +1124,9 @@ bool EspAtDrvClass::softApQuery(char* ssid, char* passphrase, uint8_t& channel,
 }
 
 bool EspAtDrvClass::ethSetMac(uint8_t* mac) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set ETH MAC "));
@@ -742,7 +1148,9 @@ bool EspAtDrvClass::ethSetMac(uint8_t* mac) {
 }
 
 bool EspAtDrvClass::ethStaticIp(const IPAddress& ip, const IPAddress& gw, const IPAddress& nm) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set ETH static IP "));
@@ -772,6 +1180,9 @@ bool EspAtDrvClass::ethStaticIp(const IPAddress& ip, const IPAddress& gw, const
 }
 
 bool EspAtDrvClass::ethEnableDHCP() {
+  ESPATDRV_LOCK();
+  maintain();
+  netConfigGeneration++;
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("enable Eth DHCP "));
   LOG_INFO_PRINTLN(persistent ? F("persistent") : F("current") );
@@ -786,6 +1197,7 @@ bool EspAtDrvClass::ethEnableDHCP() {
 }
 
 bool EspAtDrvClass::ethMacQuery(uint8_t* mac) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -804,6 +1216,7 @@ bool EspAtDrvClass::ethMacQuery(uint8_t* mac) {
 }
 
 bool EspAtDrvClass::ethIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mask) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -826,7 +1239,9 @@ bool EspAtDrvClass::ethIpQuery(IPAddress& ip, IPAddress& gwip, IPAddress& mask)
 }
 
 bool EspAtDrvClass::setEthHostname(const char* hostname) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("set eth hostname "));
@@ -839,6 +1254,7 @@ bool EspAtDrvClass::setEthHostname(const char* hostname) {
 }
 
 bool EspAtDrvClass::ethHostnameQuery(char* hostname) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -852,12 +1268,20 @@ bool EspAtDrvClass::ethHostnameQuery(char* hostname) {
 }
 
 bool EspAtDrvClass::serverBegin(uint16_t port, uint8_t maxConnCount, uint16_t serverTimeout, bool ssl, bool ca) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("begin server at port "));
   LOG_INFO_PRINTLN(port);
 
+  if (maxConnCount > LINKS_COUNT - reservedLinks) {
+    maxConnCount = LINKS_COUNT - reservedLinks;
+  }
+  if (maxConnCount == 0) {
+    maxConnCount = 1;
+  }
+  serverMaxConn = maxConnCount;
   cmd->print(F("AT+CIPSERVERMAXCONN="));
   cmd->print(maxConnCount);
   if (!sendCommand())
@@ -876,6 +1300,7 @@ bool EspAtDrvClass::serverBegin(uint16_t port, uint8_t maxConnCount, uint16_t se
 }
 
 bool EspAtDrvClass::serverEnd(uint16_t port) {
+  ESPATDRV_LOCK();
   maintain();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("stop server"));
@@ -888,35 +1313,95 @@ bool EspAtDrvClass::serverEnd(uint16_t port) {
 #endif
 }
 
+/**
+ * Incoming connections are taken from the accept queue in the order
+ * of their CONNECT messages. The queue holds linkId with serialId,
+ * so an entry of a link closed before accept is recognized and dropped.
+ */
 uint8_t EspAtDrvClass::newClientLinkId(uint16_t serverPort) {
+  ESPATDRV_LOCK();
   maintain();
-  for (int linkId = 0; linkId < LINKS_COUNT; linkId++) {
-    LinkInfo& link = linkInfo[linkId];
-    if (link.isIncoming() && !link.isClosing()) {
 #ifdef WIFIESPAT_MULTISERVER
-      if (!link.localPort) {
-        checkLinks();
-      }
-      if (serverPort != link.localPort)
-        continue;
+  for (uint8_t i = 0; i < acceptQueueLength; i++) {
+    if (!linkInfo[acceptQueue[i] & INDEX_MASK].localPort) { // AT 1 or AT 2 without +LINK_CONN
+      checkLinks(); // gets the local ports. not in the loop below, it can change the queue
+      break;
+    }
+  }
 #endif
-      LOG_INFO_PRINT_PREFIX();
-      LOG_INFO_PRINT(F("accepted incoming linkId "));
-      LOG_INFO_PRINT(linkId);
-      LOG_INFO_PRINT(F(" with serialId "));
-      LOG_INFO_PRINTLN(link.serialId);
-      link.flags &= ~LINK_IS_INCOMING;
-      return linkId | link.serialId;
+  for (uint8_t i = 0; i < acceptQueueLength; i++) {
+    uint8_t id = acceptQueue[i];
+    uint8_t linkId = id & INDEX_MASK;
+    LinkInfo& link = linkInfo[linkId];
+    if (link.serialId != (id & SERIALID_MASK) || !link.isIncoming() || link.isClosing()) {
+      acceptQueueRemove(i--);
+      continue;
     }
+#ifdef WIFIESPAT_MULTISERVER
+    if (serverPort != link.localPort)
+      continue;
+#endif
+    acceptQueueRemove(i);
+    LOG_INFO_PRINT_PREFIX();
+    LOG_INFO_PRINT(F("accepted incoming linkId "));
+    LOG_INFO_PRINT(linkId);
+    LOG_INFO_PRINT(F(" with serialId "));
+    LOG_INFO_PRINTLN(link.serialId);
+    link.flags = (link.flags & ~LINK_IS_INCOMING) | LINK_IS_ACCEPTED;
+    return id;
   }
   return NO_LINK;
 }
 
+void EspAtDrvClass::setIncomingCallback(void (*callback)()) {
+  ESPATDRV_LOCK();
+  incomingCallback = callback;
+}
+
+void EspAtDrvClass::setMaintainCallback(void (*callback)(bool idle)) {
+  ESPATDRV_LOCK();
+  maintainCallback = callback;
+}
+
+void EspAtDrvClass::reserveOutgoingLinks(uint8_t count) {
+  ESPATDRV_LOCK();
+  reservedLinks = (count < LINKS_COUNT) ? count : LINKS_COUNT - 1;
+}
+
+void EspAtDrvClass::setServerIdleTimeout(unsigned long timeout) {
+  ESPATDRV_LOCK();
+  serverIdleTimeout = timeout;
+}
+
+void EspAtDrvClass::setAcceptPolicy(EspAtAcceptPolicy policy, unsigned long minIdleTime) {
+  ESPATDRV_LOCK();
+  acceptPolicy = policy;
+  evictMinIdleTime = minIdleTime;
+}
+
+unsigned long EspAtDrvClass::linkIdleTime(uint8_t linkId) {
+  ESPATDRV_LOCK();
+  linkId = checkLinkId(linkId);
+  if (linkId == NO_LINK)
+    return 0;
+  return millis() - linkInfo[linkId].lastActivity;
+}
+
+void EspAtDrvClass::setLinkIdleTimeout(uint8_t linkId, unsigned long timeout) {
+  ESPATDRV_LOCK();
+  linkId = checkLinkId(linkId);
+  if (linkId == NO_LINK)
+    return;
+  linkInfo[linkId].idleTimeout = timeout;
+}
+
 uint8_t EspAtDrvClass::connect(const char* type, const char* host, uint16_t port,
 #ifdef WIFIESPAT1
     EspAtDrvUdpDataCallback* udpDataCallback, 
 #endif
-    uint16_t udpLocalPort) {
+    uint16_t udpLocalPort, const WiFiTlsConfig* tlsConfig) {
+  ESPATDRV_LOCK();
+  powerWake();
   maintain();
 
   uint8_t linkId = freeLinkId();
@@ -943,6 +1428,8 @@ uint8_t EspAtDrvClass::connect(const char* type, const char* host, uint16_t port
     lastErrorCode = EspAtDrvError::LINK_ALREADY_CONNECTED;
     return NO_LINK;
   }
+  if (!strcmp(type, "SSL") && !sslConfig(linkId, tlsConfig))
+    return NO_LINK;
   cmd->print(F("AT+CIPSTART="));
   cmd->print(linkId);
   cmd->print(F(",\""));
@@ -955,17 +1442,22 @@ uint8_t EspAtDrvClass::connect(const char* type, const char* host, uint16_t port
     cmd->print(',');
     cmd->print(udpLocalPort);
     cmd->print(",2");
-#ifdef WIFIESPAT_MULTISERVER
+#ifdef ESPATDRV_LINK_LOCAL_PORT
     link.localPort = udpLocalPort;
   } else {
     link.localPort = 0;
 #endif
   }
+#ifndef WIFIESPAT1
+  link.remotePort = 0;
+#endif
   link.flags = LINK_CONNECTED;
+  unsigned long start = millis();
   if (!sendCommand()) {
     link.flags = 0;
     return NO_LINK;
   }
+  lastConnectDuration = millis() - start;
   if (udpLocalPort != 0) {
     link.flags |= LINK_IS_UDP_LISTNER;
 #ifdef WIFIESPAT1
@@ -973,6 +1465,7 @@ uint8_t EspAtDrvClass::connect(const char* type, const char* host, uint16_t port
 #endif    
   }
   link.incrementSerialId();
+  link.lastActivity = millis();
   LOG_DEBUG_PRINT_PREFIX();
   LOG_DEBUG_PRINT(F(" serialId "));
   LOG_DEBUG_PRINT(link.serialId);
@@ -981,6 +1474,128 @@ uint8_t EspAtDrvClass::connect(const char* type, const char* host, uint16_t port
   return linkId | link.serialId;
 }
 
+#ifndef WIFIESPAT1
+bool EspAtDrvClass::tcpOptions(uint8_t linkId, const WiFiTcpOptions& options) {
+  ESPATDRV_LOCK();
+  maintain();
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("TCP options for link "));
+  LOG_INFO_PRINTLN(linkId & INDEX_MASK);
+
+  linkId = checkLinkId(linkId);
+  if (linkId == NO_LINK)
+    return false;
+
+  cmd->print(F("AT+CIPTCPOPT="));
+  cmd->print(linkId);
+  cmd->print(',');
+  cmd->print(options.linger);
+  cmd->print(',');
+  cmd->print(options.noDelay ? 1 : 0);
+  cmd->print(',');
+  cmd->print(options.sendTimeout);
+  cmd->print(',');
+  cmd->print(options.keepAlive);
+  return sendCommand();
+}
+#endif
+
+uint8_t EspAtDrvClass::connectAsync(const char* type, const char* host, uint16_t port, unsigned long timeout,
+    const WiFiTlsConfig* tlsConfig) {
+  ESPATDRV_LOCK();
+  powerWake();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+
+  uint8_t linkId = freeLinkId();
+  if (linkId == NO_LINK)
+    return NO_LINK;
+
+  AsyncConnect& ac = asyncConnects[linkId];
+  size_t l = strlen(host) + 1;
+  ac.host = new char[l]; // the caller's string can be temporary
+  if (!ac.host)
+    return NO_LINK;
+  memcpy(ac.host, host, l);
+  ac.type = type;
+  ac.port = port;
+  ac.timeout = timeout;
+  ac.tlsConfig = tlsConfig;
+  ac.start = millis();
+  ac.order = asyncOrder++;
+  ac.state = ASYNC_QUEUED;
+
+  LinkInfo& link = linkInfo[linkId];
+  link.flags = LINK_CONNECTING;
+#ifdef ESPATDRV_LINK_LOCAL_PORT
+  link.localPort = 0;
+#endif
+#ifndef WIFIESPAT1
+  link.remotePort = 0;
+#endif
+  link.incrementSerialId();
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("queued "));
+  LOG_INFO_PRINT(type);
+  LOG_INFO_PRINT(F(" to "));
+  LOG_INFO_PRINT(host);
+  LOG_INFO_PRINT(':');
+  LOG_INFO_PRINT(port);
+  LOG_INFO_PRINT(F(" on link "));
+  LOG_INFO_PRINTLN(linkId);
+
+  asyncConnectProcess();
+  return linkId | link.serialId;
+}
+
+EspAtConnectStatus EspAtDrvClass::connectAsyncStatus(uint8_t id) {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+  asyncConnectProcess();
+
+  if (id == NO_LINK)
+    return ESPAT_CONNECT_FAILED;
+  LinkInfo& link = linkInfo[id & INDEX_MASK];
+  if (link.serialId != (id & SERIALID_MASK))
+    return ESPAT_CONNECT_FAILED; // cancelled or timed-out
+  if (link.isConnecting())
+    return ESPAT_CONNECT_PENDING;
+  if (link.isConnected())
+    return ESPAT_CONNECT_SUCCESS;
+  return ESPAT_CONNECT_FAILED;
+}
+
+bool EspAtDrvClass::connectAsyncCancel(uint8_t id) {
+  ESPATDRV_LOCK();
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+  readRX(nullptr, false);
+
+  if (id == NO_LINK)
+    return false;
+  uint8_t linkId = id & INDEX_MASK;
+  LinkInfo& link = linkInfo[linkId];
+  if (link.serialId != (id & SERIALID_MASK))
+    return false;
+  if (!link.isConnecting()) // already connected
+    return link.isConnected() && close(id);
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("cancel connect on link "));
+  LOG_INFO_PRINTLN(linkId);
+
+  if (asyncConnects[linkId].state == ASYNC_QUEUED) {
+    asyncConnectFree(linkId);
+  } else { // the AT firmware can't stop AT+CIPSTART
+    asyncConnects[linkId].state = ASYNC_CANCELLED;
+  }
+  link.incrementSerialId(); // invalidates the caller's linkId
+  asyncConnectProcess();
+  return true;
+}
+
 uint8_t EspAtDrvClass::checkLinkId(uint8_t id) {
   if (id == NO_LINK) {
     LOG_ERROR_PRINT_PREFIX();
@@ -1010,6 +1625,7 @@ uint8_t EspAtDrvClass::checkLinkId(uint8_t id) {
 }
 
 bool EspAtDrvClass::close(uint8_t linkId, bool abort) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1039,24 +1655,26 @@ bool EspAtDrvClass::close(uint8_t linkId, bool abort) {
   return sendCommand();
 }
 
-uint16_t EspAtDrvClass::localPortQuery(uint8_t linkId) {
+uint16_t EspAtDrvClass::localPortQuery(uint8_t id) {
+  ESPATDRV_LOCK();
 
-  linkId = checkLinkId(linkId);
+  uint8_t linkId = checkLinkId(id);
   if (linkId == NO_LINK)
     return 0;
 
-#ifdef WIFIESPAT_MULTISERVER
+#ifdef ESPATDRV_LINK_LOCAL_PORT
   if (linkInfo[linkId].localPort != 0)
     return linkInfo[linkId].localPort;
 #endif
   IPAddress remoteIP;
   uint16_t remotePort;
   uint16_t localPort = 0;
-  remoteParamsQuery(linkId, remoteIP, remotePort, localPort);
+  remoteParamsQuery(id, remoteIP, remotePort, localPort);
   return localPort;
 }
 
 bool EspAtDrvClass::remoteParamsQuery(uint8_t linkId, IPAddress& remoteIP, uint16_t& remotePort, uint16_t& localPort) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1069,6 +1687,15 @@ bool EspAtDrvClass::remoteParamsQuery(uint8_t linkId, IPAddress& remoteIP, uint1
 
   LinkInfo& link = linkInfo[linkId];
 
+#ifndef WIFIESPAT1
+  if (link.remotePort) { // known from +LINK_CONN
+    remoteIP = IPAddress(link.remoteIP[0], link.remoteIP[1], link.remoteIP[2], link.remoteIP[3]);
+    remotePort = link.remotePort;
+    localPort = link.localPort;
+    return true;
+  }
+#endif
+
     cmd->print((FSH_P) AT_CIPSTATUS);
     if (!sendCommand(STATUS))
       return false;
@@ -1085,7 +1712,7 @@ bool EspAtDrvClass::remoteParamsQuery(uint8_t linkId, IPAddress& remoteIP, uint1
         remotePort = atoi(tok);
         tok = strtok(NULL, delim); // <local port>
         localPort = atoi(tok);
-#ifdef WIFIESPAT_MULTISERVER
+#ifdef ESPATDRV_LINK_LOCAL_PORT
         linkInfo[linkId].localPort = localPort;
 #endif
         readOK();
@@ -1101,7 +1728,8 @@ bool EspAtDrvClass::remoteParamsQuery(uint8_t linkId, IPAddress& remoteIP, uint1
 }
 
 bool EspAtDrvClass::connected(uint8_t linkId) {
-  maintain();
+  ESPATDRV_LOCK();
+  poll();
 
   linkId = checkLinkId(linkId);
   if (linkId == NO_LINK)
@@ -1112,7 +1740,8 @@ bool EspAtDrvClass::connected(uint8_t linkId) {
 }
 
 size_t EspAtDrvClass::availData(uint8_t linkId) {
-  maintain();
+  ESPATDRV_LOCK();
+  poll();
 
   linkId = checkLinkId(linkId);
   if (linkId == NO_LINK)
@@ -1120,14 +1749,64 @@ size_t EspAtDrvClass::availData(uint8_t linkId) {
 
   LinkInfo& link = linkInfo[linkId];
 #ifndef ESPATDRV_ASSUME_FLOW_CONTROL
-  if (link.available == 0 && !link.isClosing()) {
+  if (link.available == 0 && !link.isClosing() && !asyncCommandPending()) { // the sync sends a command
+    maintain();
     syncLinkInfo();
   }
 #endif
   return link.available;
 }
 
+void EspAtDrvClass::pollSync(bool sync) {
+  ESPATDRV_LOCK();
+  poll();
+#ifndef ESPATDRV_ASSUME_FLOW_CONTROL
+  if (sync && !asyncCommandPending()) { // the sync sends a command
+    maintain();
+    syncLinkInfo();
+  }
+#else
+  (void) sync;
+#endif
+}
+
+size_t EspAtDrvClass::pollLink(uint8_t linkId, bool& connected) {
+  ESPATDRV_LOCK();
+  connected = false;
+  if (linkId == NO_LINK)
+    return 0;
+  LinkInfo& link = linkInfo[linkId & INDEX_MASK];
+  if (!link.isConnected() || link.serialId != (linkId & SERIALID_MASK)) // no log like in checkLinkId
+    return 0;
+  connected = !link.isClosing();
+  return link.available;
+}
+
+/**
+ * Like newClientLinkId, but the connection stays in the accept queue.
+ * With multiple servers a connection with not yet known local port
+ * is reported for every server. accept() then resolves the port.
+ */
+bool EspAtDrvClass::pollIncoming(uint16_t serverPort) {
+  ESPATDRV_LOCK();
+  for (uint8_t i = 0; i < acceptQueueLength; i++) {
+    uint8_t id = acceptQueue[i];
+    LinkInfo& link = linkInfo[id & INDEX_MASK];
+    if (link.serialId != (id & SERIALID_MASK) || !link.isIncoming() || link.isClosing())
+      continue;
+#ifdef WIFIESPAT_MULTISERVER
+    if (link.localPort && serverPort != link.localPort)
+      continue;
+#else
+    (void) serverPort;
+#endif
+    return true;
+  }
+  return false;
+}
+
 size_t EspAtDrvClass::recvData(uint8_t linkId, uint8_t data[], size_t buffSize) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1165,9 +1844,9 @@ size_t EspAtDrvClass::recvData(uint8_t linkId, uint8_t data[], size_t buffSize)
 #ifdef WIFIESPAT1
   size_t len = atol(buffer + strlen("+CIPRECVDATA,")); // AT 1.7.x has : after <data_len> (not matching the doc)
 #else
-  size_t lt = serial->readBytesUntil(',', buffer, 6);
-  buffer[lt] = 0;
-  size_t len = atol(buffer);
+  IPAddress remoteIp;
+  uint16_t remotePort;
+  size_t len = recvDataHeader(remoteIp, remotePort, recvDataInfo);
 #endif
   size_t l = serial->readBytes(data, len);
   if (l != len) { //timeout
@@ -1185,6 +1864,7 @@ size_t EspAtDrvClass::recvData(uint8_t linkId, uint8_t data[], size_t buffSize)
     link.available -= len;
   }
 
+  link.lastActivity = millis();
   readOK();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1198,6 +1878,7 @@ size_t EspAtDrvClass::recvData(uint8_t linkId, uint8_t data[], size_t buffSize)
 
 //for AT2
 size_t EspAtDrvClass::recvDataWithInfo(uint8_t linkId, uint8_t data[], size_t buffSize, IPAddress& remoteIp, uint16_t& remotePort) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1237,7 +1918,7 @@ size_t EspAtDrvClass::recvDataWithInfo(uint8_t linkId, uint8_t data[], size_t bu
       link.available = len; // the rest of message will not be available
     }
   }
-  if (!simpleCommand(PSTR("AT+CIPDINFO=1")))
+  if (!recvDataInfo && !simpleCommand(PSTR("AT+CIPDINFO=1")))
     return 0;
   cmd->print(F("AT+CIPRECVDATA="));
   cmd->print(linkId);
@@ -1250,19 +1931,9 @@ size_t EspAtDrvClass::recvDataWithInfo(uint8_t linkId, uint8_t data[], size_t bu
     link.available = 0;
     lastErrorCode = EspAtDrvError::RECEIVE;
   } else {
-    size_t l = serial->readBytesUntil(',', buffer, 6);
-    buffer[l] = 0;
-    len = atol(buffer);
-    l = serial->readBytesUntil(',', buffer, 18); // IP in quotes
-    if (l > 0) {
-      buffer[l - 1] = 0;
-      remoteIp.fromString(buffer + 1);
-    }
-    l = serial->readBytesUntil(',', buffer, 6);
-    buffer[l] = 0;
-    remotePort = atol(buffer);
+    len = recvDataHeader(remoteIp, remotePort, true);
 
-    l = serial->readBytes(data, len);
+    size_t l = serial->readBytes(data, len);
     if (l != len) { //timeout
       LOG_ERROR_PRINT_PREFIX();
       LOG_ERROR_PRINT(F("error receiving on link "));
@@ -1285,12 +1956,38 @@ size_t EspAtDrvClass::recvDataWithInfo(uint8_t linkId, uint8_t data[], size_t bu
       LOG_INFO_PRINTLN(linkId);
     }
   }
-  simpleCommand(PSTR("AT+CIPDINFO=0"));
+  if (!recvDataInfo) {
+    simpleCommand(PSTR("AT+CIPDINFO=0"));
+  }
+  return len;
+}
+
+/**
+ * AT 2 +CIPRECVDATA:<actual_len>,<data> or with AT+CIPDINFO=1
+ * +CIPRECVDATA:<actual_len>,"<remote IP>",<remote port>,<data>
+ * Reads the fields before the data. "+CIPRECVDATA:" is already read.
+ */
+size_t EspAtDrvClass::recvDataHeader(IPAddress& remoteIp, uint16_t& remotePort, bool withInfo) {
+  size_t l = serial->readBytesUntil(',', buffer, 6);
+  buffer[l] = 0;
+  size_t len = atol(buffer);
+  if (!withInfo)
+    return len;
+  l = serial->readBytesUntil(',', buffer, 18); // IP in quotes
+  if (l > 0) {
+    buffer[l - 1] = 0;
+    remoteIp.fromString(buffer + 1);
+  }
+  l = serial->readBytesUntil(',', buffer, 6);
+  buffer[l] = 0;
+  remotePort = atol(buffer);
   return len;
 }
 
 size_t EspAtDrvClass::sendData(uint8_t linkId, const uint8_t data[], size_t len, const char* udpHost, uint16_t udpPort) {
-  maintain();
+  ESPATDRV_LOCK();
+  powerWake();
+  maintain(false);
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("send data on link "));
@@ -1333,6 +2030,7 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, const uint8_t data[], size_t len,
     lastErrorCode = EspAtDrvError::SEND;
     return 0;
   }
+  linkInfo[linkId].lastActivity = millis();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("\tsent "));
   LOG_INFO_PRINT(l);
@@ -1342,7 +2040,9 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, const uint8_t data[], size_t len,
 }
 
 size_t EspAtDrvClass::sendData(uint8_t linkId, Stream& file, const char* udpHost, uint16_t udpPort) {
-  maintain();
+  ESPATDRV_LOCK();
+  powerWake();
+  maintain(false);
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("send stream on link "));
@@ -1401,6 +2101,7 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, Stream& file, const char* udpHost
       LOG_WARN_PRINTLN(len);
     }
   }
+  linkInfo[linkId].lastActivity = millis();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("\tsent "));
   LOG_INFO_PRINT(len);
@@ -1410,7 +2111,9 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, Stream& file, const char* udpHost
 }
 
 size_t EspAtDrvClass::sendData(uint8_t linkId, SendCallbackFnc callback, const char* udpHost, uint16_t udpPort) {
-  maintain();
+  ESPATDRV_LOCK();
+  powerWake();
+  maintain(false);
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("send with callback on link "));
@@ -1455,6 +2158,7 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, SendCallbackFnc callback, const c
     lastErrorCode = EspAtDrvError::SEND;
     return 0;
   }
+  linkInfo[linkId].lastActivity = millis();
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINT(F("\tsent "));
   LOG_INFO_PRINT(l);
@@ -1464,7 +2168,9 @@ size_t EspAtDrvClass::sendData(uint8_t linkId, SendCallbackFnc callback, const c
 }
 
 bool EspAtDrvClass::setHostname(const char* hostname) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
 
   uint8_t mode = wifiMode | WIFI_MODE_STA; // turn on STA, leave SoftAP as it is
   if (!setWifiMode(mode, false))
@@ -1481,6 +2187,7 @@ bool EspAtDrvClass::setHostname(const char* hostname) {
 }
 
 bool EspAtDrvClass::hostnameQuery(char* hostname) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1493,7 +2200,45 @@ bool EspAtDrvClass::hostnameQuery(char* hostname) {
   return readOK();
 }
 
+/**
+ * The snapshot is valid until the next configuration change or a WIFI or +ETH message.
+ * The queries are sent in one pass only for the interfaces which are on.
+ */
+bool EspAtDrvClass::networkSnapshot(WiFiNetworkSnapshot& s) {
+  ESPATDRV_LOCK();
+  maintain();
+
+  if (s.valid && s.generation == netConfigGeneration)
+    return true;
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("network snapshot"));
+
+  uint16_t generation = netConfigGeneration;
+  s = WiFiNetworkSnapshot();
+  s.wifiMode = wifiMode;
+  bool ok = true;
+  if (wifiMode & WIFI_MODE_STA) {
+    ok = staIpQuery(s.staIp, s.staGateway, s.staSubnet) && staMacQuery(s.staMac) && ok;
+  }
+  if (wifiMode & WIFI_MODE_SAP) {
+    ok = softApIpQuery(s.apIp, s.apGateway, s.apSubnet) && softApMacQuery(s.apMac) && ok;
+  }
+  if (ethConnected) {
+    ok = ethIpQuery(s.ethIp, s.ethGateway, s.ethSubnet) && ethMacQuery(s.ethMac) && ok;
+  }
+  ok = dnsQuery(s.dns1, s.dns2) && ok;
+  ok = hostnameQuery(s.hostname) && ok;
+  ok = dhcpStateQuery(s.staDHCP, s.apDHCP, s.ethDHCP) && ok;
+  if (generation != netConfigGeneration) // a WIFI message arrived during the queries
+    return false;
+  s.generation = generation;
+  s.valid = ok;
+  return ok;
+}
+
 bool EspAtDrvClass::dhcpStateQuery(bool& staDHCP, bool& softApDHCP, bool& ethDHCP) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1515,6 +2260,7 @@ bool EspAtDrvClass::dhcpStateQuery(bool& staDHCP, bool& softApDHCP, bool& ethDHC
 }
 
 bool EspAtDrvClass::mDNS(const char* hostname, const char* serverName, uint16_t serverPort) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1530,6 +2276,7 @@ bool EspAtDrvClass::mDNS(const char* hostname, const char* serverName, uint16_t
 }
 
 bool EspAtDrvClass::resolve(const char* hostname, IPAddress& result) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1550,6 +2297,7 @@ bool EspAtDrvClass::resolve(const char* hostname, IPAddress& result) {
 }
 
 bool EspAtDrvClass::sntpCfg(const char* server1, const char* server2) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1565,22 +2313,30 @@ bool EspAtDrvClass::sntpCfg(const char* server1, const char* server2) {
   return sendCommand();
 }
 
-unsigned long EspAtDrvClass::sntpTime() {
+unsigned long EspAtDrvClass::sntpTime(unsigned long* midMillis) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("SNTP time"));
 
+  unsigned long sent = millis();
 #ifdef WIFIESPAT1
   cmd->print(F("AT+SNTPTIME?")); // AT LoBo firmware command
   if (!sendCommand(PSTR("+SNTPTIME")))
     return 0;
+  if (midMillis) {
+    *midMillis = sent + (millis() - sent) / 2;
+  }
   char* tok = strtok(buffer + strlen("+SNTPTIME:"), ",");
   unsigned long res = strtoul(tok, NULL, 10);
 #else
   cmd->print(F("AT+SYSTIMESTAMP?"));
   if (!sendCommand(PSTR("+SYSTIMESTAMP")))
     return 0;
+  if (midMillis) {
+    *midMillis = sent + (millis() - sent) / 2;
+  }
   unsigned long res = strtoul(buffer + strlen("+SYSTIMESTAMP:"), NULL, 10);
 #endif
   readOK();
@@ -1588,6 +2344,7 @@ unsigned long EspAtDrvClass::sntpTime() {
 }
 
 bool EspAtDrvClass::ping(const char* hostname) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1600,28 +2357,118 @@ bool EspAtDrvClass::ping(const char* hostname) {
 }
 
 bool EspAtDrvClass::sleepMode(EspAtSleepMode mode) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("set sleep mode"));
 
+  if (!sleepCommand(mode))
+    return false;
+  powerSleep = (powerMode != WIFI_NONE_SLEEP && mode != WIFI_NONE_SLEEP);
+  return true;
+}
+
+bool EspAtDrvClass::sleepCommand(EspAtSleepMode mode) {
   cmd->print(F("AT+SLEEP="));
+#ifdef WIFIESPAT1
   cmd->print(mode);
+#else
+  // AT 2 has 1 for modem sleep and 2 for light sleep
+  cmd->print(mode == WIFI_LIGHT_SLEEP ? 2 : mode == WIFI_MODEM_SLEEP ? 1 : 0);
+#endif
   return sendCommand();
 }
 
+void EspAtDrvClass::setPowerSchedule(EspAtSleepMode mode, unsigned long idleTime) {
+  ESPATDRV_LOCK();
+  if (mode == WIFI_NONE_SLEEP) {
+    powerWake();
+  }
+  powerMode = mode;
+  powerIdleTime = idleTime;
+  powerActivity = millis();
+}
+
+/**
+ * Sets the sleep mode of the power schedule if all links are idle
+ * for the idle time, no data wait to be read and no asynchronous command runs.
+ */
+void EspAtDrvClass::powerMaintain() {
+  if (powerMode == WIFI_NONE_SLEEP || powerSleep || powerMaintaining)
+    return;
+  if (asyncLinkId != NO_LINK || scanStatus == ESPAT_SCAN_RUNNING || joinStatus == ESPAT_CONNECT_PENDING)
+    return;
+  unsigned long idleTime = millis() - powerActivity;
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) {
+    LinkInfo& link = linkInfo[linkId];
+    if (asyncConnects[linkId].state != ASYNC_NONE || link.available)
+      return;
+    if (link.isConnected() && millis() - link.lastActivity < idleTime) {
+      idleTime = millis() - link.lastActivity;
+    }
+  }
+  if (idleTime < powerIdleTime)
+    return;
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("power schedule sleep"));
+  powerMaintaining = true;
+  if (sleepCommand(powerMode)) {
+    powerSleep = true;
+    powerSleepStart = millis();
+    powerStatistics.sleepCount++;
+  } else {
+    powerActivity = millis(); // try again after the idle time
+  }
+  powerMaintaining = false;
+}
+
+/**
+ * Called before a connect or send. Leaves the sleep mode of the power schedule
+ * and measures the time of the wake-up command.
+ */
+void EspAtDrvClass::powerWake() {
+  powerActivity = millis(); // maintain() will not enter the sleep
+  if (!powerSleep || powerMaintaining)
+    return;
+  powerMaintaining = true;
+  maintain();
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINTLN(F("power schedule wake-up"));
+  unsigned long start = millis();
+  if (sleepCommand(WIFI_NONE_SLEEP)) {
+    powerSleep = false;
+    unsigned long latency = millis() - start;
+    EspAtPowerStats& stats = powerStatistics;
+    stats.sleepTime += start - powerSleepStart;
+    stats.lastWakeLatency = latency;
+    stats.totalWakeLatency += latency;
+    if (latency > stats.maxWakeLatency) {
+      stats.maxWakeLatency = latency;
+    }
+  }
+  powerMaintaining = false;
+  powerActivity = millis();
+}
+
 bool EspAtDrvClass::wifiOff(bool save) {
+  ESPATDRV_LOCK();
   maintain();
+  netConfigGeneration++;
   return setWifiMode(0, save);
 }
 
 bool EspAtDrvClass::deepSleep() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
   LOG_INFO_PRINTLN(F("deep sleep"));
 
-  return simpleCommand(PSTR("AT+GSLP=0"));
+  if (!simpleCommand(PSTR("AT+GSLP=0")))
+    return false;
+  staStateChange(ESPAT_STA_UNKNOWN); // no WIFI message is received in sleep
+  return true;
 }
 
 void EspAtDrvClass::ip2str(const IPAddress& ip, char* s) {
@@ -1641,6 +2488,7 @@ void EspAtDrvClass::ip2str(const IPAddress& ip, char* s) {
  * BLE section
  ****************************************************************************/
 bool EspAtDrvClass::bleInit(int role) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1657,6 +2505,7 @@ bool EspAtDrvClass::bleInit(int role) {
  * addr_type 1 = Random address
  */
 bool EspAtDrvClass::setPublicBdAddr(const char *addr, bool addr_type) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1671,6 +2520,7 @@ bool EspAtDrvClass::setPublicBdAddr(const char *addr, bool addr_type) {
 }
 
 char * EspAtDrvClass::getPublicBdAddr() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1687,6 +2537,7 @@ char * EspAtDrvClass::getPublicBdAddr() {
 }
 
 bool EspAtDrvClass::setName(const char *name) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1700,6 +2551,7 @@ bool EspAtDrvClass::setName(const char *name) {
 }
 
 char *EspAtDrvClass::getName() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1716,6 +2568,7 @@ char *EspAtDrvClass::getName() {
 }
 
 bool EspAtDrvClass::setScanParams(const char *scan_params) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1728,6 +2581,7 @@ bool EspAtDrvClass::setScanParams(const char *scan_params) {
 }
 
 bool EspAtDrvClass::startScan(const char *scan_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1745,6 +2599,7 @@ bool EspAtDrvClass::startScan(const char *scan_string) {
  *                <peer_addr>][,<primary_phy>,<secondary_phy>]
 */
 bool EspAtDrvClass::setAdvertisementParams(const char *adv_params) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1757,6 +2612,7 @@ bool EspAtDrvClass::setAdvertisementParams(const char *adv_params) {
 }
 
 bool EspAtDrvClass::setAdvData(const char *adv_data) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1770,6 +2626,7 @@ bool EspAtDrvClass::setAdvData(const char *adv_data) {
 }
 
 bool EspAtDrvClass::startAdvertising() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1779,6 +2636,7 @@ bool EspAtDrvClass::startAdvertising() {
 }
 
 bool EspAtDrvClass::stopAdvertising() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1788,6 +2646,7 @@ bool EspAtDrvClass::stopAdvertising() {
 }
 
 bool EspAtDrvClass::startAdvertisingEx(const char *adv_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1800,10 +2659,12 @@ bool EspAtDrvClass::startAdvertisingEx(const char *adv_string) {
 }
 
 void EspAtDrvClass::process() {
+  ESPATDRV_LOCK();
   maintain();
 }
 
 bool EspAtDrvClass::bleConnect(const char *connection_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1818,6 +2679,7 @@ bool EspAtDrvClass::bleConnect(const char *connection_string) {
 }
 
 bool EspAtDrvClass::updateConnParams(const char *param_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1830,6 +2692,7 @@ bool EspAtDrvClass::updateConnParams(const char *param_string) {
 }
 
 bool EspAtDrvClass::updateMtuSize(const char *mtu_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1842,6 +2705,7 @@ bool EspAtDrvClass::updateMtuSize(const char *mtu_string) {
 }
 
 char *EspAtDrvClass::getMtuSize() {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1859,6 +2723,7 @@ char *EspAtDrvClass::getMtuSize() {
 }
 
 bool EspAtDrvClass::discoverCGATTServices(const char *gatt_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1871,6 +2736,7 @@ bool EspAtDrvClass::discoverCGATTServices(const char *gatt_string) {
 }
 
 bool EspAtDrvClass::discoverCGATTServicesCharacteristics(const char *gattc_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1883,6 +2749,7 @@ bool EspAtDrvClass::discoverCGATTServicesCharacteristics(const char *gattc_strin
 }
 
 bool EspAtDrvClass::discoverCGATTIncludedServices(const char *gattc_string) {
+  ESPATDRV_LOCK();
   maintain();
 
   LOG_INFO_PRINT_PREFIX();
@@ -1898,16 +2765,16 @@ bool EspAtDrvClass::discoverCGATTIncludedServices(const char *gattc_string) {
  * Private section
  ****************************************************************************/
 uint8_t EspAtDrvClass::freeLinkId() {
-  maintain();
   for (int linkId = LINKS_COUNT - 1; linkId >= 0; linkId--) {
     LinkInfo& link = linkInfo[linkId];
-    if (!link.isConnected() && !link.isClosing() && !link.available) {
+    if (!link.isConnected() && !link.isClosing() && !link.isConnecting() && !link.available) {
       LOG_INFO_PRINT_PREFIX();
       LOG_INFO_PRINT(F("free linkId is "));
       LOG_INFO_PRINTLN(linkId);
       return linkId;
     }
   }
+  lastErrorCode = EspAtDrvError::NO_FREE_LINK;
   return NO_LINK;
 }
 
@@ -1934,6 +2801,7 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
       }
       // next we send an invalid command to AT.
       cmd->println("?");
+      probesPending++;
       // response is:
       // nothing if the firmware doesn't respond at all. readBytes will timeout again
       // "busy p..." if still processing a command. will be printed to debug output and ignored
@@ -1959,7 +2827,7 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
         continue;
       char terminator = '\n';
       if (buffer[0] == '+') { // +IPD, +CIP
-        if (buffer[1] == 'C' && !bufferData) { // +CIP
+        if (buffer[1] == 'C' && !bufferData && scanStatus != ESPAT_SCAN_RUNNING) { // +CIP. (+CWLAP lines of scanAsync are read whole)
           terminator = ':';
 #ifdef WIFIESPAT1
         } else if (buffer[1] == 'I') { // +IPD
@@ -1990,6 +2858,44 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
     }
     LOG_DEBUG_PRINT_PREFIX();
     LOG_DEBUG_PRINT(buffer);
+    if (scanStatus == ESPAT_SCAN_RUNNING) { // AT+CWLAP sent by scanAsync
+      if (!strncmp_P(buffer, PSTR("+CWLAP:"), strlen("+CWLAP:"))) {
+        LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
+        WiFiApData ap;
+        if (parseAP(ap) && scanCallback) {
+          scanCallback(ap);
+        }
+        continue;
+      }
+      if (!strcmp_P(buffer, OK) || !strcmp_P(buffer, PSTR("ERROR")) || !strcmp_P(buffer, PSTR("FAIL"))) {
+        LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
+        scanStatus = (buffer[0] == 'O') ? ESPAT_SCAN_DONE : ESPAT_SCAN_FAILED;
+        return true;
+      }
+    }
+    if (joinStatus == ESPAT_CONNECT_PENDING && (!strcmp_P(buffer, OK) || !strcmp_P(buffer, PSTR("ERROR")) || !strcmp_P(buffer, PSTR("FAIL")))) {
+      // the result of AT+CWJAP sent by joinAPAsync
+      LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
+      joinStatus = (buffer[0] == 'O') ? ESPAT_CONNECT_SUCCESS : ESPAT_CONNECT_FAILED;
+      if (buffer[0] == 'O') {
+        staStateChange(ESPAT_STA_GOT_IP);
+      }
+      return true;
+    }
+    if (asyncLinkId != NO_LINK && (!strcmp_P(buffer, OK) || !strcmp_P(buffer, PSTR("ERROR")) || !strcmp_P(buffer, PSTR("FAIL")))) {
+      // the result of AT+CIPSTART sent by connectAsync. no other command is sent while it is pending.
+      // OK is its result only after the CONNECT of the link and ERROR only if no '?' check is unanswered
+      if (buffer[0] == 'O' ? asyncConnectSeen : !probesPending) {
+        LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
+        asyncConnectResult(buffer[0] == 'O');
+        return true;
+      }
+      if (buffer[0] != 'O') {
+        probesPending--;
+      }
+      LOG_DEBUG_PRINTLN((FSH_P) IGNORED);
+      continue;
+    }
     if (expected && strncmp_P(buffer, expected, strlen_P(expected)) == 0) { // startsWith
       LOG_DEBUG_PRINTLN(F(" ...matched"));
       return true;
@@ -1999,6 +2905,7 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
       size_t len = atol(buffer + SL_IPD + 2);
       if (linkId >= 0 && linkId < LINKS_COUNT && len > 0) {
         LinkInfo& link = linkInfo[linkId];
+        link.lastActivity = millis();
 #ifdef WIFIESPAT1
         if (!link.isUdpListener()) {
 #endif        
@@ -2007,7 +2914,9 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
 #ifdef WIFIESPAT1
         } else { // UDP listener
           LOG_DEBUG_PRINTLN(F(":<DATA>"));
-          uint8_t res = link.udpDataCallback->readRxData(serial, len);
+          IPAddress remoteIP;
+          uint16_t remotePort = ipdSender(remoteIP);
+          uint8_t res = link.udpDataCallback->readRxData(serial, len, remoteIP, remotePort);
           if (res == EspAtDrvUdpDataCallback::OK) {
             LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
           } else {
@@ -2029,21 +2938,19 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
 #endif
       }
     } else if (strcmp_P(buffer + 1, PSTR(",CONNECT")) == 0) {
-      uint8_t linkId = buffer[0] - 48;
-      LinkInfo& link = linkInfo[linkId];
-      if (link.available == 0 && (!link.isConnected() || link.isClosing())) { // incoming connection (and we could miss CLOSED)
-        link.flags = LINK_CONNECTED | LINK_IS_INCOMING;
-#ifdef WIFIESPAT_MULTISERVER
-        link.localPort = 0;
-#endif
-        link.incrementSerialId();
+      if (linkConnected(buffer[0] - 48)) {
         LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
       } else {
         LOG_DEBUG_PRINTLN((FSH_P) IGNORED);
       }
+#ifndef WIFIESPAT1
+    } else if (!strncmp_P(buffer, PSTR("+LINK_CONN:"), strlen("+LINK_CONN:"))) {
+      linkConnMessage();
+      LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
+#endif
     } else if ((strcmp_P(buffer + 1, PSTR(",CLOSED")) == 0 || strcmp_P(buffer + 1, PSTR(",CONNECT FAIL")) == 0)) {
       uint8_t linkId = buffer[0] - 48;
-      linkInfo[linkId].flags = 0;
+      linkInfo[linkId].flags &= LINK_CONNECTING; // connectAsync is evaluated on ERROR
 #ifndef WIFIESPAT1 //AT2
       linkInfo[linkId].available = 0; // AT2 sends CLOSED only after all data are read
 #endif
@@ -2056,6 +2963,9 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
         LOG_DEBUG_PRINTLN(F(" ...UNLINK is OK"));
         return true;
       }
+      if (probesPending) {
+        probesPending--;
+      }
       if (expected == nullptr || !strcmp_P("ready", expected)) {
         LOG_DEBUG_PRINTLN((FSH_P) IGNORED); // it is only a late response to timeout query '?'
       } else {
@@ -2077,14 +2987,33 @@ bool EspAtDrvClass::readRX(PGM_P expected, bool bufferData, bool listItem) {
       LOG_ERROR_PRINTLN(buffer);
       lastErrorCode = EspAtDrvError::NO_AP;
       return false;
+    } else if (!strncmp_P(buffer, PSTR("busy "), strlen("busy "))) { // the firmware is busy with the previous command
+      if (probesPending) { // the answer to '?'
+        probesPending--;
+      }
+      LOG_DEBUG_PRINTLN((FSH_P) IGNORED);
     } else if (!strcmp_P(buffer, PSTR("UNLINK"))) {
       unlinkBug = true;
       LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
     } else if (listItem && !strcmp_P(buffer, OK)) { // OK ends the listing of unknown items count
       LOG_DEBUG_PRINTLN(F(" ...end of list"));
       return false;
+    } else if (!strncmp_P(buffer, PSTR("WIFI "), strlen("WIFI "))) {
+      const char* event = buffer + strlen("WIFI ");
+      // every message invalidates, a GOT IP in GOT_IP state can be a new DHCP lease or a missed DISCONNECT
+      staIpCached = false;
+      netConfigGeneration++;
+      if (!strcmp_P(event, PSTR("DISCONNECT"))) {
+        staStateChange(ESPAT_STA_DISCONNECTED);
+      } else if (!strcmp_P(event, PSTR("CONNECTED"))) {
+        staStateChange(ESPAT_STA_CONNECTED);
+      } else if (!strcmp_P(event, PSTR("GOT IP"))) {
+        staStateChange(ESPAT_STA_GOT_IP);
+      }
+      LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
     } else if (!strncmp_P(buffer, PSTR("+ETH"), strlen("+ETH"))) {
       ethConnected = (buffer[strlen("+ETH_")] != 'D'); // +ETH_DISCONNECTED
+      netConfigGeneration++;
       LOG_DEBUG_PRINTLN((FSH_P) PROCESSED);
     } else {
       ignoredCount++;
@@ -2129,6 +3058,7 @@ bool EspAtDrvClass::setWifiMode(uint8_t mode, bool save) {
 
   if (mode == wifiMode && (!save || mode == wifiModeDef)) // no change
     return true;
+  netConfigGeneration++;
 
 #ifdef WIFIESPAT1
   cmd->print(save ? F("AT+CWMODE=") : F("AT+CWMODE_CUR="));
@@ -2195,11 +3125,11 @@ bool EspAtDrvClass::recvLenQuery() {
 #else
       LinkInfo& link = linkInfo[linkId];
       if (tok[0] == '-') { // AT V2 sends -1 for inactive links
-        link.flags = 0;
+        link.flags &= LINK_CONNECTING; // queued connectAsync keeps the link reserved
         link.available = 0;
       } else {
         if (!link.isConnected() || link.isClosing()) { // missed incoming connection
-          link.flags = LINK_CONNECTED | LINK_IS_INCOMING;
+          linkIncoming(linkId);
         }
         link.available = atol(tok);
       }
@@ -2221,6 +3151,10 @@ bool EspAtDrvClass::checkLinks() {
   while (readRX(CIPSTATUS, true, true)) {
     uint8_t linkId = buffer[strlen("+CIPSTATUS:")] - 48;
     ok[linkId] = true;
+    LinkInfo& link = linkInfo[linkId];
+    if (!link.isConnected() || link.isClosing()) { // missed incoming connection
+      linkIncoming(linkId);
+    }
 #ifdef WIFIESPAT_MULTISERVER
     const char* delim = ",\"";
     char* tok = strtok(buffer, delim); // +CIPSTATUS:<link  ID>
@@ -2228,25 +3162,415 @@ bool EspAtDrvClass::checkLinks() {
     tok = strtok(NULL, delim); // <remote IP>
     tok = strtok(NULL, delim); // <remote port>
     tok = strtok(NULL, delim); // <local port>
-    linkInfo[linkId].localPort = atoi(tok);
+    link.localPort = atoi(tok);
 #endif
   }
   for (int linkId = 0; linkId < LINKS_COUNT; linkId++) {
-    LinkInfo& link = linkInfo[linkId];
-    if (ok[linkId]) {
-      if (!link.isConnected() || link.isClosing()) { // missed incoming connection
-        link.flags = LINK_CONNECTED | LINK_IS_INCOMING;
-        link.incrementSerialId();
+    if (!ok[linkId]) { // not connected
+      linkInfo[linkId].flags &= LINK_CONNECTING; // queued connectAsync keeps the link reserved
+    }
+  }
+  return true;
+}
+#endif
+
+/**
+ * AT firmware processes one command at a time. While AT+CIPSTART of connectAsync
+ * is in progress, the AT firmware would answer "busy p..." to other commands,
+ * so the next connectAsync waits in queue and other commands wait in maintain().
+ */
+void EspAtDrvClass::asyncConnectResult(bool ok) {
+  uint8_t linkId = asyncLinkId;
+  asyncLinkId = NO_LINK;
+  AsyncConnect& ac = asyncConnects[linkId];
+  LinkInfo& link = linkInfo[linkId];
+  delete[] ac.host;
+  ac.host = nullptr;
+  if (ok) {
+    lastConnectDuration = millis() - asyncSentMillis;
+    link.flags = LINK_CONNECTED;
+    link.lastActivity = millis();
+    ac.state = (ac.state == ASYNC_CANCELLED) ? ASYNC_CLOSE : ASYNC_NONE;
+  } else {
+    link.flags = 0;
+    ac.state = ASYNC_NONE;
+  }
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("connect on link "));
+  LOG_INFO_PRINT(linkId);
+  LOG_INFO_PRINTLN(ok ? F(" done") : F(" failed"));
+}
+
+/**
+ * Waits for OK or ERROR of AT+CIPSTART, which are handled in readRX.
+ * The wait is limited by the connect timeout of the request and not by
+ * the readRX timeout, because a TLS handshake can take long. '?' is not
+ * sent to check the firmware, its ERROR could be taken for the result.
+ */
+void EspAtDrvClass::asyncConnectWait() {
+  while (asyncLinkId != NO_LINK) {
+    if (millis() - asyncSentMillis > asyncConnects[asyncLinkId].timeout) {
+      LOG_WARN_PRINT_PREFIX();
+      LOG_WARN_PRINT(F("no result of connect on link "));
+      LOG_WARN_PRINTLN(asyncLinkId);
+      asyncConnectFree(asyncLinkId);
+      asyncLinkId = NO_LINK;
+      break;
+    }
+    if (serial->available()) {
+      readRX(nullptr, false);
+    } else {
+      yield();
+    }
+  }
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) {
+    if (asyncConnects[linkId].state == ASYNC_CLOSE) {
+      asyncConnects[linkId].state = ASYNC_NONE;
+      close(linkId | linkInfo[linkId].serialId);
+    }
+  }
+}
+
+void EspAtDrvClass::asyncConnectProcess() {
+  uint8_t next = NO_LINK;
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) {
+    AsyncConnect& ac = asyncConnects[linkId];
+    if (ac.state == ASYNC_CLOSE && asyncLinkId == NO_LINK) {
+      ac.state = ASYNC_NONE;
+      close(linkId | linkInfo[linkId].serialId);
+    }
+    if (ac.state != ASYNC_QUEUED && ac.state != ASYNC_SENT)
+      continue;
+    if (millis() - ac.start > ac.timeout) {
+      LOG_WARN_PRINT_PREFIX();
+      LOG_WARN_PRINT(F("connect timeout on link "));
+      LOG_WARN_PRINTLN(linkId);
+      if (ac.state == ASYNC_QUEUED) {
+        asyncConnectFree(linkId);
+      } else {
+        ac.state = ASYNC_CANCELLED;
       }
-    } else { // not connected
-      link.flags = 0;
+      linkInfo[linkId].incrementSerialId();
+      continue;
+    }
+    if (ac.state == ASYNC_QUEUED && (next == NO_LINK || (int8_t) (ac.order - asyncConnects[next].order) < 0)) {
+      next = linkId;
+    }
+  }
+  if (asyncLinkId == NO_LINK && next != NO_LINK && scanStatus != ESPAT_SCAN_RUNNING && joinStatus != ESPAT_CONNECT_PENDING) {
+    asyncConnectSend(next);
+  }
+}
+
+void EspAtDrvClass::asyncConnectSend(uint8_t linkId) {
+  AsyncConnect& ac = asyncConnects[linkId];
+
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(F("start "));
+  LOG_INFO_PRINT(ac.type);
+  LOG_INFO_PRINT(F(" to "));
+  LOG_INFO_PRINT(ac.host);
+  LOG_INFO_PRINT(F(" on link "));
+  LOG_INFO_PRINTLN(linkId);
+
+  if (!strcmp(ac.type, "SSL") && !sslConfig(linkId, ac.tlsConfig)) {
+    asyncConnectFree(linkId);
+    return;
+  }
+  cmd->print(F("AT+CIPSTART="));
+  cmd->print(linkId);
+  cmd->print(F(",\""));
+  cmd->print(ac.type);
+  cmd->print((FSH_P) QOUT_COMMA_QOUT);
+  cmd->print(ac.host);
+  cmd->print(F("\","));
+  cmd->print(ac.port);
+  LOG_DEBUG_PRINT(F(" ...sent"));
+  cmd->println(); // OK or ERROR will be read by readRX
+  ac.state = ASYNC_SENT;
+  asyncLinkId = linkId;
+  asyncConnectSeen = false;
+  asyncSentMillis = millis();
+}
+
+void EspAtDrvClass::asyncConnectFree(uint8_t linkId) {
+  AsyncConnect& ac = asyncConnects[linkId];
+  delete[] ac.host;
+  ac.host = nullptr;
+  ac.state = ASYNC_NONE;
+  linkInfo[linkId].flags = 0;
+}
+
+/**
+ * The AT firmware doesn't offer TLS session resumption,
+ * so only the handshake parameters can be set.
+ */
+bool EspAtDrvClass::sslConfig(uint8_t linkId, const WiFiTlsConfig* config) {
+#ifdef WIFIESPAT1
+  (void) linkId;
+  if (!config || !config->bufferSize || config->bufferSize == sslBufferSize)
+    return true;
+  cmd->print(F("AT+CIPSSLSIZE="));
+  cmd->print(config->bufferSize);
+  if (!sendCommand())
+    return false;
+  sslBufferSize = config->bufferSize;
+  return true;
+#else
+  uint8_t linkBit = (1 << linkId);
+  if (!config) {
+    if (sslConfiguredLinks & linkBit) {
+      // remove the authentication settings of the previous connection on this link
+      cmd->print(F("AT+CIPSSLCCONF="));
+      cmd->print(linkId);
+      cmd->print(F(",0"));
+      if (!sendCommand())
+        return false;
+      sslConfiguredLinks &= ~linkBit;
+    }
+  } else {
+    LOG_INFO_PRINT_PREFIX();
+    LOG_INFO_PRINT(F("SSL config for link "));
+    LOG_INFO_PRINTLN(linkId);
+
+    sslConfiguredLinks |= linkBit;
+    cmd->print(F("AT+CIPSSLCCONF="));
+    cmd->print(linkId);
+    cmd->print(',');
+    cmd->print(config->authMode);
+    if (config->authMode) {
+      cmd->print(',');
+      cmd->print(config->pkiNumber);
+      cmd->print(',');
+      cmd->print(config->caNumber);
+    }
+    if (!sendCommand())
+      return false;
+  }
+
+  // SNI and ALPN of the previous connection on this link are cleared if not set again
+  const char* sni = config ? config->sni : nullptr;
+  if (sni || (sslSniLinks & linkBit)) {
+    cmd->print(F("AT+CIPSSLCSNI="));
+    cmd->print(linkId);
+    cmd->print(F(",\""));
+    if (sni) {
+      cmd->print(sni);
+    }
+    cmd->print('"');
+    if (!sendCommand())
+      return false;
+    if (sni) {
+      sslSniLinks |= linkBit;
+    } else {
+      sslSniLinks &= ~linkBit;
+    }
+  }
+
+  uint8_t count = 0;
+  while (config && count < 3 && config->alpn[count]) {
+    count++;
+  }
+  if (count || (sslAlpnLinks & linkBit)) {
+    cmd->print(F("AT+CIPSSLCALPN="));
+    cmd->print(linkId);
+    cmd->print(',');
+    cmd->print(count); // 0 clears the ALPN list
+    for (uint8_t i = 0; i < count; i++) {
+      cmd->print(F(",\""));
+      cmd->print(config->alpn[i]);
+      cmd->print('"');
+    }
+    if (!sendCommand())
+      return false;
+    if (count) {
+      sslAlpnLinks |= linkBit;
+    } else {
+      sslAlpnLinks &= ~linkBit;
+    }
+  }
+  return true;
+#endif
+}
+
+/**
+ * evaluates CONNECT of a link. returns true for a new incoming connection
+ */
+bool EspAtDrvClass::linkConnected(uint8_t linkId) {
+  LinkInfo& link = linkInfo[linkId];
+  if (link.isConnecting()) { // CONNECT of connectAsync. OK follows
+    if (linkId == asyncLinkId) {
+      asyncConnectSeen = true;
     }
+    return false;
   }
+  if (link.available != 0 || (link.isConnected() && !link.isClosing())) // CONNECT of connect()
+    return false;
+  // incoming connection (and we could miss CLOSED)
+  linkIncoming(linkId);
   return true;
 }
+
+/**
+ * Marks a new incoming connection on the link and queues it for accept.
+ * The endpoint of the previous connection on the link is cleared.
+ */
+void EspAtDrvClass::linkIncoming(uint8_t linkId) {
+  LinkInfo& link = linkInfo[linkId];
+  link.flags = LINK_CONNECTED | LINK_IS_INCOMING;
+#ifdef ESPATDRV_LINK_LOCAL_PORT
+  link.localPort = 0;
+#endif
+#ifndef WIFIESPAT1
+  link.remotePort = 0;
+#endif
+  link.incrementSerialId();
+  acceptQueuePush(linkId);
+}
+
+#ifndef WIFIESPAT1
+/**
+ * AT+SYSMSG=2 replaces "<link ID>,CONNECT" with
+ * +LINK_CONN:<status>,<link ID>,"<type>",<c/s>,"<remote IP>",<remote port>,<local port>
+ */
+void EspAtDrvClass::linkConnMessage() {
+  const char* delim = ",\"";
+  char* tok = strtok(buffer + strlen("+LINK_CONN:"), delim); // <status>
+  if (!tok || tok[0] != '0') // failed connection. ERROR follows
+    return;
+  tok = strtok(NULL, delim); // <link ID>
+  if (!tok)
+    return;
+  uint8_t linkId = atoi(tok);
+  if (linkId >= LINKS_COUNT)
+    return;
+  char* type = strtok(NULL, delim);
+  tok = strtok(NULL, delim); // <c/s> 0 client, 1 server
+  if (!type || !tok)
+    return;
+  if (tok[0] == '1') {
+    linkConnected(linkId);
+  } else if (linkId == asyncLinkId) { // +LINK_CONN of AT+CIPSTART replaces CONNECT
+    asyncConnectSeen = true;
+  }
+  LinkInfo& link = linkInfo[linkId];
+  IPAddress ip;
+  tok = strtok(NULL, delim); // <remote IP>
+  if (tok) {
+    ip.fromString(tok);
+  }
+  tok = strtok(NULL, delim); // <remote port>
+  uint16_t remotePort = tok ? atoi(tok) : 0;
+  tok = strtok(NULL, delim); // <local port>
+  link.localPort = tok ? atoi(tok) : 0;
+  if (strcmp(type, "UDP")) { // the remote side of UDP can change with every message
+    for (uint8_t i = 0; i < 4; i++) {
+      link.remoteIP[i] = ip[i];
+    }
+    link.remotePort = remotePort;
+  }
+}
+#endif
+
+#ifdef WIFIESPAT1
+/**
+ * With AT+CIPDINFO=1 AT 1 sends +IPD,<link ID>,<len>,<remote IP>,<remote port>:<data>
+ * The buffer has the message until ':'. Returns the port, 0 if the sender is not in the message.
+ */
+uint16_t EspAtDrvClass::ipdSender(IPAddress& remoteIP) {
+  char* ip = strchr(buffer + strlen("+IPD,0,"), ',');
+  if (!ip)
+    return 0;
+  ip++;
+  if (*ip == '"') {
+    ip++;
+  }
+  char* port = strchr(ip, ',');
+  if (!port)
+    return 0;
+  *port = 0;
+  if (port[-1] == '"') {
+    port[-1] = 0;
+  }
+  remoteIP.fromString(ip);
+  return atol(port + 1);
+}
 #endif
 
-void EspAtDrvClass::printMAC(Print* out, uint8_t* mac) {
+void EspAtDrvClass::acceptQueuePush(uint8_t linkId) {
+  for (uint8_t i = 0; i < acceptQueueLength; i++) {
+    if ((acceptQueue[i] & INDEX_MASK) == linkId) { // missed CLOSED of a not accepted connection
+      acceptQueueRemove(i);
+      break;
+    }
+  }
+  acceptQueue[acceptQueueLength++] = linkId | linkInfo[linkId].serialId;
+  linkInfo[linkId].lastActivity = millis();
+  incomingPending = true;
+}
+
+/**
+ * Server connections idle longer than the idle timeout are closed.
+ * With the evict policy, if all server connection slots are used,
+ * the least recently active server connection is closed, so the AT firmware
+ * can take the next connection. Runs from maintain() before the command.
+ */
+void EspAtDrvClass::linksMaintain() {
+  if (linksMaintaining)
+    return;
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) { // timeouts set with setLinkIdleTimeout
+    LinkInfo& link = linkInfo[linkId];
+    if (!link.idleTimeout || !link.isConnected() || link.isClosing() || millis() - link.lastActivity <= link.idleTimeout)
+      continue;
+    LOG_INFO_PRINT_PREFIX();
+    LOG_INFO_PRINT(F("idle timeout of linkId "));
+    LOG_INFO_PRINTLN(linkId);
+    link.idleTimeout = 0;
+    linksMaintaining = true;
+    close(linkId | link.serialId);
+    linksMaintaining = false;
+  }
+  if (!serverIdleTimeout && acceptPolicy != ESPAT_ACCEPT_EVICT_IDLE)
+    return;
+  uint8_t serverLinks = 0;
+  uint8_t lruLinkId = NO_LINK;
+  unsigned long lruIdleTime = 0;
+  for (uint8_t linkId = 0; linkId < LINKS_COUNT; linkId++) {
+    LinkInfo& link = linkInfo[linkId];
+    if (!link.isConnected() || link.isClosing() || !link.isServerLink())
+      continue;
+    serverLinks++;
+    unsigned long idleTime = millis() - link.lastActivity;
+    if (link.available || idleTime < lruIdleTime)
+      continue;
+    lruLinkId = linkId;
+    lruIdleTime = idleTime;
+  }
+  if (lruLinkId == NO_LINK)
+    return;
+  bool expired = serverIdleTimeout && lruIdleTime > serverIdleTimeout;
+  bool evict = acceptPolicy == ESPAT_ACCEPT_EVICT_IDLE && serverMaxConn && serverLinks >= serverMaxConn
+      && lruIdleTime >= evictMinIdleTime;
+  if (!expired && !evict)
+    return;
+  LOG_INFO_PRINT_PREFIX();
+  LOG_INFO_PRINT(expired ? F("idle timeout") : F("evict idle"));
+  LOG_INFO_PRINT(F(" of linkId "));
+  LOG_INFO_PRINTLN(lruLinkId);
+  linksMaintaining = true;
+  close(lruLinkId | linkInfo[lruLinkId].serialId);
+  linksMaintaining = false;
+  lastErrorCode = EspAtDrvError::NO_ERROR;
+}
+
+void EspAtDrvClass::acceptQueueRemove(uint8_t index) {
+  acceptQueueLength--;
+  for (uint8_t i = index; i < acceptQueueLength; i++) {
+    acceptQueue[i] = acceptQueue[i + 1];
+  }
+}
+
+void EspAtDrvClass::printMAC(Print* out, const uint8_t* mac) {
   for (int i = 0; i < 6; i++) {
     if (i > 0) {
       out->print(":");
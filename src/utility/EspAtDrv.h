@@ -23,6 +23,7 @@
 #include <Arduino.h>
 #include <IPAddress.h>
 #include "utility/EspAtDrvTypes.h"
+#include "utility/EspAtDrvLock.h"
 
 const uint8_t LINKS_COUNT = WIFIESPAT_LINKS_COUNT;
 const uint8_t NO_LINK = WIFIESPAT_NO_LINK;
@@ -32,19 +33,30 @@ const uint8_t LINK_CLOSING = (1 << 1);
 const uint8_t LINK_IS_INCOMING = (1 << 2);
 const uint8_t LINK_IS_ACCEPTED = (1 << 3);
 const uint8_t LINK_IS_UDP_LISTNER = (1 << 4);
+const uint8_t LINK_CONNECTING = (1 << 5); // connectAsync queued or in progress
 
 const uint8_t INDEX_MASK = 0b111;
 const uint8_t SERIALID_MASK = ~INDEX_MASK;
 
 //#define WIFIESPAT_MULTISERVER
 
+#if defined(WIFIESPAT_MULTISERVER) || !defined(WIFIESPAT1)
+#define ESPATDRV_LINK_LOCAL_PORT // AT 2 gets the local port in +LINK_CONN
+#endif
+
 struct LinkInfo {
   uint8_t serialId = 0;
   uint8_t flags = 0;
   size_t available = 0;
-#ifdef WIFIESPAT_MULTISERVER
+  unsigned long lastActivity = 0; // millis of connect, received data or sent data
+  unsigned long idleTimeout = 0; // closed in maintain() if idle longer. 0 for no timeout
+#ifdef ESPATDRV_LINK_LOCAL_PORT
   uint16_t localPort = 0;
 #endif
+#ifndef WIFIESPAT1
+  uint8_t remoteIP[4] = {0, 0, 0, 0};
+  uint16_t remotePort = 0; // 0 if not known from +LINK_CONN
+#endif
 
 #ifdef WIFIESPAT1
   EspAtDrvUdpDataCallback* udpDataCallback;
@@ -54,12 +66,32 @@ struct LinkInfo {
   bool isClosing() { return flags & LINK_CLOSING;}
   bool isIncoming() { return flags & LINK_IS_INCOMING;}
   bool isUdpListener() { return flags & LINK_IS_UDP_LISTNER;}
+  bool isConnecting() { return flags & LINK_CONNECTING;}
+  bool isServerLink() { return flags & (LINK_IS_INCOMING | LINK_IS_ACCEPTED);}
 
-  void incrementSerialId() {
+  void incrementSerialId() { // a new connection on the link
     serialId += (INDEX_MASK + 1);
+    idleTimeout = 0;
   }
 };
 
+const uint8_t ASYNC_NONE = 0;
+const uint8_t ASYNC_QUEUED = 1;
+const uint8_t ASYNC_SENT = 2;
+const uint8_t ASYNC_CANCELLED = 3; // sent, but the result will be discarded
+const uint8_t ASYNC_CLOSE = 4; // cancelled connection was established
+
+struct AsyncConnect {
+  const char* type = nullptr;
+  char* host = nullptr;
+  uint16_t port = 0;
+  uint8_t state = ASYNC_NONE;
+  uint8_t order = 0; // the queue is processed in the order of requests
+  unsigned long start = 0;
+  unsigned long timeout = 0;
+  const WiFiTlsConfig* tlsConfig = nullptr;
+};
+
 class EspAtDrvClass {
 public:
   void setUnsolicitedMessageCallback(bool (*callback)(char *buffer));
@@ -75,7 +107,11 @@ public:
   int staStatus();
   int ethStatus();
 
-  uint8_t listAP(WiFiApData apData[], uint8_t size); // returns count of filled records
+  // returns count of filled records
+  uint8_t listAP(WiFiApData apData[], uint8_t size, const WiFiScanFilter* filter = nullptr);
+  // starts AT+CWLAP and returns. the callback gets the APs passing the filter as they are received
+  bool scanAsync(EspAtScanCallback callback, const WiFiScanFilter* filter = nullptr);
+  EspAtScanStatus scanAsyncStatus(); // doesn't wait for the AT firmware
 
   bool setDNS(const IPAddress& dns1, const IPAddress& dns2);
   bool dnsQuery(IPAddress& dns1, IPAddress& dns2);
@@ -88,6 +124,11 @@ public:
   bool joinAP(const char* ssid, const char* password, const uint8_t* bssid);
   bool joinEAP(const char* ssid, uint8_t method, const char* identity, const char* username, const char* password, uint8_t security);
   bool quitAP(bool save);
+  // sends AT+CWJAP and returns. other commands wait for the end of the join
+  bool joinAPAsync(const char* ssid, const char* password, const uint8_t* bssid = nullptr);
+  EspAtConnectStatus joinAPAsyncStatus(); // doesn't wait for the AT firmware
+  bool joinAPAsyncCancel(); // waits for the end of the join and quits the AP if joined
+  EspAtStaState staState(); // doesn't wait for the AT firmware
   bool staAutoConnect(bool autoConnect);
   bool apQuery(char* ssid, uint8_t* bssid, uint8_t& channel, int8_t& rssi);
 
@@ -111,13 +152,38 @@ public:
   bool serverBegin(uint16_t port, uint8_t maxConnCount = 1, uint16_t serverTimeout = 60, bool ssl = false, bool ca = false);
   bool serverEnd(uint16_t port);
   uint8_t newClientLinkId(uint16_t serverPort);
+  // called after a CONNECT of an incoming connection from maintain() or poll(). not from the send functions
+  void setIncomingCallback(void (*callback)());
+  // called from maintain() before the command of the calling function and with idle true
+  // from functions which don't send a command. only an idle call can start an async command
+  void setMaintainCallback(void (*callback)(bool idle));
+
+  // links kept free of incoming connections for outgoing connections. limits the maxConnCount of serverBegin
+  void reserveOutgoingLinks(uint8_t count);
+  // server connections (accepted or not) idle longer than the timeout are closed. 0 disables
+  void setServerIdleTimeout(unsigned long timeout);
+  // with ESPAT_ACCEPT_EVICT_IDLE a server connection idle at least minIdleTime is closed if all slots are used
+  void setAcceptPolicy(EspAtAcceptPolicy policy, unsigned long minIdleTime = 5000);
+  unsigned long linkIdleTime(uint8_t linkId); // milliseconds since the last activity on the link
+  // the connection is closed in maintain() if idle longer than the timeout. 0 disables
+  void setLinkIdleTimeout(uint8_t linkId, unsigned long timeout);
 
   uint8_t connect(const char* type, const char* host, uint16_t port, //
 #ifdef WIFIESPAT1
       EspAtDrvUdpDataCallback* udpDataCallback = nullptr, 
 #endif      
-      uint16_t udpLocalPort = 0);
+      uint16_t udpLocalPort = 0, const WiFiTlsConfig* tlsConfig = nullptr);
   bool close(uint8_t linkId, bool abort = false);
+  unsigned long connectDuration() {return lastConnectDuration;} // milliseconds of the last AT+CIPSTART
+#ifndef WIFIESPAT1
+  bool tcpOptions(uint8_t linkId, const WiFiTcpOptions& options); // AT 2
+#endif
+
+  // returns the linkId of the pending connection or NO_LINK. type must be a string literal
+  uint8_t connectAsync(const char* type, const char* host, uint16_t port, unsigned long timeout = 10000,
+      const WiFiTlsConfig* tlsConfig = nullptr);
+  EspAtConnectStatus connectAsyncStatus(uint8_t linkId); // doesn't wait for the AT firmware
+  bool connectAsyncCancel(uint8_t linkId);
 
   uint16_t localPortQuery(uint8_t linkId);
   bool remoteParamsQuery(uint8_t linkId, IPAddress& remoteIP, uint16_t& remotePort, uint16_t& localPort);
@@ -125,6 +191,12 @@ public:
   bool connected(uint8_t linkId);
   size_t availData(uint8_t linkId);
 
+  // for WiFiPoll. pollSync processes the received messages and with sync true
+  // syncs the state of all links (throttled). the poll functions send no command
+  void pollSync(bool sync);
+  size_t pollLink(uint8_t linkId, bool& connected);
+  bool pollIncoming(uint16_t serverPort);
+
   size_t recvData(uint8_t linkId, uint8_t buff[], size_t buffSize);
   size_t recvDataWithInfo(uint8_t linkId, uint8_t buff[], size_t buffSize, IPAddress& remoteIP, uint16_t& remotePort);
   size_t sendData(uint8_t linkId, const uint8_t buff[], size_t dataLength, const char* udpHost, uint16_t udpPort);
@@ -134,14 +206,22 @@ public:
   bool setHostname(const char* hostname);
   bool hostnameQuery(char* hostname);
   bool dhcpStateQuery(bool& staDHCP, bool& softApDHCP, bool& ethDHCP);
+  // reads the configuration of all interfaces. without queries if nothing changed since the last snapshot
+  bool networkSnapshot(WiFiNetworkSnapshot& snapshot);
+  // changes with every configuration function, WIFI message or +ETH message
+  uint16_t netConfigGenerationQuery() {return netConfigGeneration;}
   bool mDNS(const char* hostname, const char* serverName, uint16_t serverPort);
   bool resolve(const char* hostname, IPAddress& result);
   bool sntpCfg(const char* server1, const char* server2);
-  unsigned long sntpTime();
+  unsigned long sntpTime(unsigned long* midMillis = nullptr); // midMillis is the middle of the round-trip
   bool ping(const char* hostname);
 
   bool wifiOff(bool save = false);
   bool sleepMode(EspAtSleepMode mode);
+  // sleep mode after all links were idle for idleTime. connect and send leave it first. WIFI_NONE_SLEEP disables
+  void setPowerSchedule(EspAtSleepMode mode, unsigned long idleTime);
+  bool powerSleeping() {return powerSleep;}
+  const EspAtPowerStats& powerStats() {return powerStatistics;}
   bool deepSleep();
 
   void ip2str(const IPAddress& ip, char* s);
@@ -192,7 +272,59 @@ private:
   LinkInfo linkInfo[LINKS_COUNT];
   EspAtDrvError lastErrorCode = EspAtDrvError::NOT_INITIALIZED;
   unsigned long lastSyncMillis;
+  AsyncConnect asyncConnects[LINKS_COUNT];
+  uint8_t asyncLinkId = NO_LINK; // AT+CIPSTART sent and waiting for OK or ERROR
+  bool asyncConnectSeen = false; // CONNECT of asyncLinkId was received
+  uint8_t probesPending = 0; // '?' sent on readRX timeout and not yet answered
+  uint8_t asyncOrder = 0;
+  unsigned long asyncSentMillis = 0;
+  unsigned long lastConnectDuration = 0;
+  EspAtScanCallback scanCallback = nullptr;
+  WiFiScanFilter scanFilter;
+  EspAtScanStatus scanStatus = ESPAT_SCAN_DONE;
+  EspAtConnectStatus joinStatus = ESPAT_CONNECT_SUCCESS; // ESPAT_CONNECT_PENDING while joinAPAsync runs
+  EspAtStaState staStateValue = ESPAT_STA_UNKNOWN;
+  unsigned long staStateMillis = 0;
+  uint16_t netConfigGeneration = 1;
+  EspAtSleepMode powerMode = WIFI_NONE_SLEEP;
+  unsigned long powerIdleTime = 0;
+  unsigned long powerActivity = 0;
+  unsigned long powerSleepStart = 0;
+  bool powerSleep = false;
+  bool powerMaintaining = false;
+  EspAtPowerStats powerStatistics;
+  bool staIpCached = false; // valid only while the STA state is known
+  IPAddress staIp;
+  IPAddress staGw;
+  IPAddress staMask;
+  void (*maintainCallback)(bool idle) = nullptr;
+  bool maintainDispatching = false;
+  uint8_t apPrintMask = 0; // last AT+CWLAPOPT. 0 is not set
+  int8_t apRssiFilter = -100;
+  uint8_t acceptQueue[LINKS_COUNT]; // incoming connections not yet accepted
+  uint8_t acceptQueueLength = 0;
+  void (*incomingCallback)() = nullptr;
+  bool incomingPending = false;
+  bool incomingDispatching = false;
+  uint8_t reservedLinks = 0;
+  uint8_t serverMaxConn = 0;
+  unsigned long serverIdleTimeout = 0;
+  EspAtAcceptPolicy acceptPolicy = ESPAT_ACCEPT_REJECT;
+  unsigned long evictMinIdleTime = 0;
+  bool linksMaintaining = false;
+  uint8_t sslConfiguredLinks = 0; // AT 2 keeps the SSL settings of a link
+  uint8_t sslSniLinks = 0; // links with AT+CIPSSLCSNI set
+  uint8_t sslAlpnLinks = 0; // links with AT+CIPSSLCALPN set
+  bool recvDataInfo = false; // AT+CIPDINFO=1 is set
+#ifdef WIFIESPAT1
+  uint16_t sslBufferSize = 0;
+#endif
 
+  void maintain(bool dispatchIncoming);
+  void poll();
+  void maintainDispatch(bool idle);
+  void incomingDispatch();
+  bool asyncCommandPending();
   uint8_t freeLinkId();
   uint8_t checkLinkId(uint8_t linkId);
 
@@ -205,10 +337,39 @@ private:
   bool syncLinkInfo();
   bool recvLenQuery();
   bool checkLinks();
+  bool sslConfig(uint8_t linkId, const WiFiTlsConfig* config);
+  bool linkConnected(uint8_t linkId);
+  void linkIncoming(uint8_t linkId);
+#ifndef WIFIESPAT1
+  void linkConnMessage();
+#endif
+  void acceptQueuePush(uint8_t linkId);
+#ifdef WIFIESPAT1
+  uint16_t ipdSender(IPAddress& remoteIP);
+#endif
+  void linksMaintain();
+  void powerMaintain();
+  void powerWake();
+  bool sleepCommand(EspAtSleepMode mode);
+  void acceptQueueRemove(uint8_t index);
+
+  void staStateChange(EspAtStaState state);
+  bool joinStart(const char* ssid, const char* password, const uint8_t* bssid);
+  void joinWait();
+  bool scanStart(const WiFiScanFilter* filter);
+  bool parseAP(WiFiApData& ap); // false if filtered out
+  void scanWait();
+
+  void asyncConnectResult(bool ok);
+  void asyncConnectWait();
+  void asyncConnectProcess();
+  void asyncConnectSend(uint8_t linkId);
+  void asyncConnectFree(uint8_t linkId);
 
   bool sysStoreInternal(bool store); // AT 2
+  size_t recvDataHeader(IPAddress& remoteIp, uint16_t& remotePort, bool withInfo); // AT 2
 
-  void printMAC(Print* out, uint8_t* mac);
+  void printMAC(Print* out, const uint8_t* mac);
 };
 
 extern EspAtDrvClass EspAtDrv;
@@ -0,0 +1,73 @@
+/*
+  This file is part of the iLabsEspAT library for iLabs Challenger
+  products: https://github.com/PontusO/iLabs_EspAT
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ESP_AT_DRV_LOCK_H_
+#define _ESP_AT_DRV_LOCK_H_
+
+/**
+ * With WIFIESPAT_THREAD_SAFE the EspAtDrv functions and the buffers pool
+ * are guarded by one recursive lock, so networking objects can be used from
+ * both cores of RP2040 (or from more RTOS tasks). A command exchange with
+ * the AT firmware is never interleaved with a command from the other core.
+ * One WiFiClient/WiFiUDP object still must be used only from one core.
+ */
+//#define WIFIESPAT_THREAD_SAFE
+
+#ifdef WIFIESPAT_THREAD_SAFE
+
+#if defined(ARDUINO_ARCH_RP2040)
+#include <pico/mutex.h>
+#else
+#include <mutex>
+#endif
+
+class EspAtDrvLock {
+public:
+#if defined(ARDUINO_ARCH_RP2040)
+  EspAtDrvLock() { recursive_mutex_init(&mutex); }
+  void lock() { recursive_mutex_enter_blocking(&mutex); }
+  void unlock() { recursive_mutex_exit(&mutex); }
+private:
+  recursive_mutex_t mutex;
+#else
+  void lock() { mutex.lock(); }
+  void unlock() { mutex.unlock(); }
+private:
+  std::recursive_mutex mutex;
+#endif
+};
+
+class EspAtDrvLockGuard {
+public:
+  EspAtDrvLockGuard(EspAtDrvLock& _lock) : lock(_lock) { lock.lock(); }
+  ~EspAtDrvLockGuard() { lock.unlock(); }
+private:
+  EspAtDrvLock& lock;
+};
+
+extern EspAtDrvLock espAtDrvLock;
+
+#define ESPATDRV_LOCK() EspAtDrvLockGuard espAtDrvLockGuard(espAtDrvLock)
+
+#else
+
+#define ESPATDRV_LOCK()
+
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 #define _ESPATDRV_TYPES_H_
 
 #include <Arduino.h>
+#include <IPAddress.h>
 
 #ifndef WIFIESPAT2 // for -D
 #define WIFIESPAT1
@@ -43,7 +44,53 @@ enum struct EspAtDrvError {
   SEND,
   UDP_BUSY,
   UDP_LARGE,
-  UDP_TIMEOUT
+  UDP_TIMEOUT,
+  NO_FREE_LINK
+};
+
+// STA state tracked from the WIFI CONNECTED, WIFI GOT IP and WIFI DISCONNECT messages
+enum EspAtStaState {
+  ESPAT_STA_UNKNOWN,
+  ESPAT_STA_DISCONNECTED,
+  ESPAT_STA_CONNECTED,
+  ESPAT_STA_GOT_IP
+};
+
+enum EspAtConnectStatus {
+  ESPAT_CONNECT_PENDING,
+  ESPAT_CONNECT_SUCCESS,
+  ESPAT_CONNECT_FAILED
+};
+
+/**
+ * TLS settings for an SSL connection. AT 2 applies them per link
+ * before AT+CIPSTART. AT 1.7 has only the global SSL buffer size.
+ * The strings must be valid while the connection is started.
+ */
+struct WiFiTlsConfig {
+  uint8_t authMode = 0; // AT+CIPSSLCCONF. 0 none, 1 client cert, 2 server CA, 3 both
+  uint8_t pkiNumber = 0;
+  uint8_t caNumber = 0;
+  const char* sni = nullptr; // AT+CIPSSLCSNI
+  const char* alpn[3] = {nullptr, nullptr, nullptr}; // AT+CIPSSLCALPN
+  uint16_t bufferSize = 0; // AT 1.7 AT+CIPSSLSIZE (2048 to 4096). 0 for default
+};
+
+/**
+ * AT 2 socket options of a TCP link (AT+CIPTCPOPT).
+ * The firmware sets TCP keep-alive with the idle time only,
+ * the probes interval is 1 second and the probes count is 3.
+ */
+struct WiFiTcpOptions {
+  int16_t linger = -1; // SO_LINGER seconds. -1 disabled
+  bool noDelay = false; // TCP_NODELAY disables Nagle's algorithm
+  uint16_t sendTimeout = 0; // SO_SNDTIMEO milliseconds. 0 never
+  uint16_t keepAlive = 0; // seconds of idle before the keep-alive probes (1 to 7200). 0 disabled
+};
+
+enum EspAtAcceptPolicy {
+  ESPAT_ACCEPT_REJECT, // the AT firmware refuses connections over the server's max count
+  ESPAT_ACCEPT_EVICT_IDLE // the least recently active idle server connection is closed to keep a free slot
 };
 
 enum EspAtSleepMode {
@@ -52,6 +99,14 @@ enum EspAtSleepMode {
   WIFI_MODEM_SLEEP = 2
 };
 
+struct EspAtPowerStats {
+  unsigned long sleepCount = 0;
+  unsigned long sleepTime = 0; // milliseconds in sleep mode until the last wake-up
+  unsigned long lastWakeLatency = 0; // milliseconds of AT+SLEEP=0 before a send
+  unsigned long maxWakeLatency = 0;
+  unsigned long totalWakeLatency = 0;
+};
+
 struct WiFiApData {
    char ssid[33];
    uint8_t bssid[6];
@@ -60,6 +115,80 @@ struct WiFiApData {
    uint8_t enc;
 };
 
+// AT+CWLAPOPT print mask. the fields not printed stay zero in WiFiApData
+enum EspAtApFields {
+  WIFI_AP_ENC = 1,
+  WIFI_AP_SSID = 2,
+  WIFI_AP_RSSI = 4,
+  WIFI_AP_BSSID = 8,
+  WIFI_AP_CHANNEL = 16,
+  WIFI_AP_ALL = 31
+};
+
+/**
+ * The AP and the DHCP addresses of a successful join for WiFi.beginFast().
+ * Only plain values, so the sketch can keep it over a deep sleep (RTC memory, EEPROM).
+ */
+struct WiFiFastConnectProfile {
+  bool valid = false;
+  char ssid[33];
+  uint8_t bssid[6];
+  uint8_t channel; // AT+CWJAP has no channel parameter. for information
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t subnet[4];
+  uint8_t dns[4];
+};
+
+/**
+ * The network configuration read by EspAtDrv.networkSnapshot().
+ * The values of the interfaces which are off stay zero.
+ */
+struct WiFiNetworkSnapshot {
+  bool valid = false;
+  uint16_t generation = 0; // netConfigGeneration at the time of the snapshot
+  uint8_t wifiMode = 0;
+  IPAddress staIp;
+  IPAddress staGateway;
+  IPAddress staSubnet;
+  uint8_t staMac[6] = {0};
+  IPAddress apIp;
+  IPAddress apGateway;
+  IPAddress apSubnet;
+  uint8_t apMac[6] = {0};
+  IPAddress ethIp; // only if the firmware reported the Ethernet state
+  IPAddress ethGateway;
+  IPAddress ethSubnet;
+  uint8_t ethMac[6] = {0};
+  IPAddress dns1;
+  IPAddress dns2;
+  char hostname[33] = {0};
+  bool staDHCP = false;
+  bool apDHCP = false;
+  bool ethDHCP = false;
+};
+
+/**
+ * Options of a scan. ssid, bssid and channel are sent as AT+CWLAP parameters
+ * so the AT firmware scans only for them. The strings must be valid while the scan runs.
+ */
+struct WiFiScanFilter {
+  const char* ssid = nullptr; // only this SSID. nullptr for all
+  const uint8_t* bssid = nullptr; // only this AP. requires ssid
+  uint8_t channel = 0; // 0 for all channels
+  int8_t minRssi = -128; // AT 2 filters in firmware, AT 1 in the library
+  uint8_t fields = WIFI_AP_ALL; // EspAtApFields to print
+};
+
+enum EspAtScanStatus {
+  ESPAT_SCAN_RUNNING,
+  ESPAT_SCAN_DONE,
+  ESPAT_SCAN_FAILED
+};
+
+// called from the library functions while the scan runs. must not use the networking functions
+typedef void (*EspAtScanCallback)(const WiFiApData& ap);
+
 #ifdef WIFIESPAT1
 class EspAtDrvUdpDataCallback {
 protected:
@@ -69,7 +198,8 @@ protected:
   static const uint8_t LARGE = 2;
   static const uint8_t TIMEOUT = 3;
 
-  virtual uint8_t readRxData(Stream* serial, size_t len) = 0;
+  // remotePort is 0 if the AT firmware doesn't send the sender (AT+CIPDINFO)
+  virtual uint8_t readRxData(Stream* serial, size_t len, const IPAddress& remoteIP, uint16_t remotePort) = 0;
   friend EspAtDrvClass;
 };
 #endif